@@ -2,11 +2,20 @@
  * An advanced calculator that takes in a line and evalucate it as an math
  * expression.
  */
+#include <cerrno>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <cctype>
 #include <cmath>
+#include <limits>
 #include <vector>
 #include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "fast_input.h"
 
 using std::vector;
 using std::overflow_error;
@@ -176,44 +185,60 @@ class stack_releaser {
   }
 };
 
-int main() {
-  char ch = '\0';
-  char last_ch = '\0';
-  double operand = 0;
+/**
+ * What a line leaves to the next. A line with an error is skipped from the
+ * error on, so the digits read before the error are carried over, and the
+ * last character is reset.
+ */
+struct LineState {
+  char last_ch;
+  double operand;
+};
+
+const LineState kInitialState = {'\0', 0};
+
+// Calculates the lines of `input`, starting in `state`, and leaves `state` as
+// the input ends.
+void calculate(FastInput &input, LineState &state) {
+  int c;
+  char last_ch = state.last_ch;
+  double operand = state.operand;
   bool error_mod = false;
-  while ((ch = getchar()) != EOF) {
+  while ((c = input.get()) != EOF) {
+    char ch = c;
     if (error_mod) {
-      if (ch == '\n') {
-        stack_releaser releaser;
-        error_mod = false;
-        last_ch = '\0';
+      // The rest of the line is skipped at once.
+      if (ch != '\n' && !input.skip_line()) {
+        break;
       }
+      stack_releaser releaser;
+      error_mod = false;
+      last_ch = '\0';
       continue;
     }
-    if (isdigit(ch)) {
+    if (char_class[ch] == kDigitChar) {
       if (last_ch == ')') {
         printf("Expecting operators following ')' but got digit %c.\n", ch);
         error_mod = true;
         continue;
       }
       operand = operand * 10 + (ch - '0');
-    } else if (ch == '+' || ch == '-' || ch == '*' || ch == '/' || ch == '^'
-        || ch == '(' || ch == ')' || ch == '~') {
+    } else if (char_class[ch] == kOperatorChar) {
       if (ch == '(' || is_unary_operator(ch)) {
-        if (isdigit(last_ch) || last_ch == ')') {
+        if (char_class[last_ch] == kDigitChar || last_ch == ')') {
           printf("Unexpected operator '%c' following '%c'.\n", ch, last_ch);
           error_mod = true;
           continue;
         }
       } else {
-        if (!isdigit(last_ch) && last_ch != ')') {
+        if (char_class[last_ch] != kDigitChar && last_ch != ')') {
           printf("Unexpected operator '%c' following '%c'.\n", ch, last_ch);
           error_mod = true;
           continue;
         }
       }
 
-      if (isdigit(last_ch)) {
+      if (char_class[last_ch] == kDigitChar) {
         // We've got a whole number.
         num_stack.push_back(new Num(operand));
         operand = 0; // Clear the input number cache.
@@ -272,9 +297,9 @@ int main() {
           // Do nothing, ignore.
           break;
       }
-    } else if (ch == '\n') {
+    } else if (char_class[ch] == kNewlineChar) {
       stack_releaser releaser;
-      if (isdigit(last_ch)) {
+      if (char_class[last_ch] == kDigitChar) {
         // Another number.
         num_stack.push_back(new Num(operand));
       } else if (last_ch != ')') {
@@ -317,4 +342,188 @@ int main() {
     }
     last_ch = ch;
   }
+  state.last_ch = last_ch;
+  state.operand = operand;
+}
+
+// Runs the calculator on a range of whole lines of `fd`, starting in `state`.
+LineState calculate_range(int fd, off_t begin, off_t end, LineState state) {
+  FastInput input(fd, begin, end);
+  calculate(input, state);
+  return state;
+}
+
+// Returns the start of the line after `offset`, or `size`.
+off_t next_line_start(int fd, off_t offset, off_t size) {
+  char block[4096];
+  while (offset < size) {
+    ssize_t n = pread(fd, block, sizeof(block), offset);
+    if (n <= 0) {
+      break;
+    }
+    const char *newline = (const char *) memchr(block, '\n', n);
+    if (newline != nullptr) {
+      return offset + (newline - block) + 1;
+    }
+    offset += n;
+  }
+  return size;
+}
+
+// Returns the start of the line ending right before `offset`.
+off_t line_start_before(int fd, off_t offset) {
+  char block[4096];
+  // Skips the newline ending the line.
+  off_t end = offset - 1;
+  while (end > 0) {
+    off_t begin = end > (off_t) sizeof(block) ? end - sizeof(block) : 0;
+    ssize_t n = pread(fd, block, end - begin, begin);
+    if (n <= 0) {
+      break;
+    }
+    const char *newline = (const char *) memrchr(block, '\n', n);
+    if (newline != nullptr) {
+      return begin + (newline - block) + 1;
+    }
+    end = begin;
+  }
+  return 0;
+}
+
+/**
+ * Returns the state in which the line starting at `offset` is calculated when
+ * the whole file is, without calculating the whole file before it. Whether a
+ * line has an error does not depend on the lines before, so only the digits
+ * carried over lines with errors are looked for, back to a line that carries
+ * the same digits whatever it was given.
+ *
+ * The lines are calculated again to find out, so their output must be thrown
+ * away.
+ */
+LineState state_at(int fd, off_t offset) {
+  off_t known = 0;
+  LineState state = kInitialState;
+  for (off_t line_end = offset; line_end > 0; ) {
+    off_t line_begin = line_start_before(fd, line_end);
+    LineState given_zero = {'\0', 0};
+    LineState given_one = {'\0', 1};
+    given_zero = calculate_range(fd, line_begin, line_end, given_zero);
+    given_one = calculate_range(fd, line_begin, line_end, given_one);
+    if (given_zero.operand == given_one.operand) {
+      known = line_end;
+      state = given_zero;
+      break;
+    }
+    line_end = line_begin;
+  }
+  return calculate_range(fd, known, offset, state);
+}
+
+/**
+ * Splits the file into `shards` ranges of whole lines, calculates each in a
+ * process of its own, and writes their outputs in order. The output is the
+ * same as calculating the file in one go. Returns false if a process failed.
+ */
+bool calculate_sharded(int fd, int shards) {
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    perror("fstat");
+    return false;
+  }
+  vector<off_t> bounds(1, 0);
+  for (int i = 1; i < shards; i++) {
+    off_t bound = next_line_start(fd, st.st_size / shards * i, st.st_size);
+    bounds.push_back(bound < bounds.back() ? bounds.back() : bound);
+  }
+  bounds.push_back(st.st_size);
+
+  // Buffered output would be written again by every child.
+  fflush(stdout);
+  vector<FILE *> outputs;
+  vector<pid_t> children;
+  bool ok = true;
+  for (int i = 0; i < shards; i++) {
+    FILE *out = tmpfile();
+    if (out == nullptr) {
+      perror("tmpfile");
+      ok = false;
+      break;
+    }
+    outputs.push_back(out);
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      ok = false;
+      break;
+    }
+    if (pid == 0) {
+      LineState state = kInitialState;
+      if (bounds[i] > 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        state = state_at(fd, bounds[i]);
+        fflush(stdout);
+      }
+      dup2(fileno(out), STDOUT_FILENO);
+      calculate_range(fd, bounds[i], bounds[i + 1], state);
+      _exit(fflush(stdout) == 0 ? 0 : 1);
+    }
+    children.push_back(pid);
+  }
+
+  for (pid_t pid : children) {
+    int status;
+    if (waitpid(pid, &status, 0) < 0
+        || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "A shard failed.\n");
+      ok = false;
+    }
+  }
+  char block[64 * 1024];
+  for (FILE *out : outputs) {
+    if (ok) {
+      rewind(out);
+      size_t n;
+      while ((n = fread(block, 1, sizeof(block), out)) > 0) {
+        fwrite(block, 1, n, stdout);
+      }
+    }
+    fclose(out);
+  }
+  return ok;
+}
+
+/**
+ * Usage: advanced [--shards=N] [file]
+ *
+ * Reads the lines from `file` if given, otherwise from stdin. With N shards,
+ * a file, or stdin redirected from one, is calculated by N processes, see
+ * `calculate_sharded()`.
+ */
+int main(int argc, char **argv) {
+  int shards = 1;
+  const char *path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--shards=", 9) == 0) {
+      shards = atoi(argv[i] + 9);
+    } else if (argv[i][0] != '-' && path == nullptr) {
+      path = argv[i];
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  int fd = STDIN_FILENO;
+  if (path != nullptr && (fd = open(path, O_RDONLY)) < 0) {
+    fprintf(stderr, "Cannot read %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+  struct stat st;
+  if (shards > 1 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    return calculate_sharded(fd, shards) ? 0 : 1;
+  }
+  FastInput input(fd);
+  LineState state = kInitialState;
+  calculate(input, state);
+  return 0;
 }
@@ -0,0 +1,129 @@
+#ifndef FAST_INPUT_H
+#define FAST_INPUT_H
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <unistd.h>
+
+/**
+ * Classes of the characters the calculator cares about. A lookup in a table
+ * of 256 entries replaces `isdigit()` and the long chains of comparisons
+ * against each operator.
+ */
+enum CharClass {
+  kOtherChar,
+  kDigitChar,
+  kOperatorChar,
+  kNewlineChar,
+};
+
+class CharClassTable {
+  unsigned char classes[256];
+
+  public:
+  CharClassTable() {
+    memset(classes, kOtherChar, sizeof(classes));
+    for (int c = '0'; c <= '9'; c++) {
+      classes[c] = kDigitChar;
+    }
+    for (const char *op = "+-*/^()~"; *op; op++) {
+      classes[(unsigned char) *op] = kOperatorChar;
+    }
+    classes['\n'] = kNewlineChar;
+  }
+
+  int operator[](char c) const {
+    return classes[(unsigned char) c];
+  }
+};
+
+static const CharClassTable char_class;
+
+/**
+ * Reads a file descriptor in large blocks with read(2), and hands out one
+ * byte at a time from the block. Unlike `getchar()`, getting a byte is an
+ * inlined pointer comparison, with no locking of a `FILE`.
+ *
+ * A range of a file can be read instead, with pread(2), which leaves the
+ * offset of the file descriptor alone for other readers.
+ */
+class FastInput {
+  static const size_t kBlockSize = 1 << 20;
+
+  int fd;
+  // Next offset to read and end of the range, or -1 when reading with read(2).
+  off_t offset;
+  off_t end_offset;
+  char *buffer;
+  const char *cur;
+  const char *end;
+
+  // Reads the next block. Returns false at the end of the input.
+  bool fill() {
+    ssize_t n;
+    do {
+      if (end_offset < 0) {
+        n = read(fd, buffer, kBlockSize);
+      } else if (offset == end_offset) {
+        n = 0;
+      } else {
+        size_t size = end_offset - offset < (off_t) kBlockSize
+          ? end_offset - offset : kBlockSize;
+        n = pread(fd, buffer, size, offset);
+      }
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+      cur = end = buffer;
+      return false;
+    }
+    if (end_offset >= 0) {
+      offset += n;
+    }
+    cur = buffer;
+    end = buffer + n;
+    return true;
+  }
+
+  public:
+  explicit FastInput(int fd = STDIN_FILENO)
+    : fd(fd), offset(-1), end_offset(-1), buffer(new char[kBlockSize]),
+      cur(buffer), end(buffer) {}
+
+  // Reads the bytes of the file from `range_begin` up to `range_end`.
+  FastInput(int fd, off_t range_begin, off_t range_end)
+    : fd(fd), offset(range_begin), end_offset(range_end), buffer(new char[kBlockSize]),
+      cur(buffer), end(buffer) {}
+
+  ~FastInput() {
+    delete[] buffer;
+  }
+
+  FastInput(const FastInput &) = delete;
+  FastInput &operator=(const FastInput &) = delete;
+
+  // Returns the next byte, or EOF at the end of the input.
+  int get() {
+    if (cur == end && !fill()) {
+      return EOF;
+    }
+    return (unsigned char) *cur++;
+  }
+
+  // Skips everything up to and including the next newline, a block at a time.
+  // Returns false if the input ends first.
+  bool skip_line() {
+    for (;;) {
+      const char *newline = (const char *) memchr(cur, '\n', end - cur);
+      if (newline != nullptr) {
+        cur = newline + 1;
+        return true;
+      }
+      if (!fill()) {
+        return false;
+      }
+    }
+  }
+};
+
+#endif
@@ -5,10 +5,12 @@
 #include <cstdio>
 #include <cctype>
 #include <cmath>
+#include <limits>
 #include <vector>
 #include <stdexcept>
 #include <string>
 #include "lexer.h"
+#include "token_buffer.h"
 #include "arith_expr.h"
 #include "interpreter.h"
 #include "variable.h"
@@ -23,6 +25,12 @@ bool Expr::is_zero(double value) {
 
 const double Expr::esp = std::numeric_limits<double>::epsilon();
 
+thread_local EvalStatus eval_status;
+
+void EvalStatus::throw_error(ErrorCode code) {
+  THROW_ERROR(RuntimeError, code);
+}
+
 class Num: public Expr {
   double value;
 
@@ -31,7 +39,8 @@ class Num: public Expr {
 
   protected:
   int evaluate_as_int() const override {
-    throw RuntimeError("Cannot evaluate num as int.");
+    fail(ErrorCode::NumAsInt);
+    return 0;
   }
 
   double evaluate_as_double() const override {
@@ -45,6 +54,10 @@ class Idn: public Expr {
   public:
   Idn(const Variable &var) : var(var), Expr(var.type()) {}
 
+  void collect_reads(vector<const Variable *> &reads) const override {
+    reads.push_back(&var);
+  }
+
   /**
    * HOMEWORK 1: Identifier as an Expression
    *
@@ -78,6 +91,16 @@ class AddExpr: public Expr {
   AddExpr(Expr* left, Expr* right) : left(left), right(right),
                                      Expr(choose_type(left, right)) {}
 
+  ~AddExpr() {
+    delete left;
+    delete right;
+  }
+
+  void collect_reads(vector<const Variable *> &reads) const override {
+    left->collect_reads(reads);
+    right->collect_reads(reads);
+  }
+
   protected:
   int evaluate_as_int() const override {
     return left->evaluate_as_int() + right->evaluate_as_int();
@@ -97,6 +120,16 @@ class SubExpr: public Expr {
   SubExpr(Expr* left, Expr* right) : left(left), right(right),
                                      Expr(choose_type(left, right)) {}
 
+  ~SubExpr() {
+    delete left;
+    delete right;
+  }
+
+  void collect_reads(vector<const Variable *> &reads) const override {
+    left->collect_reads(reads);
+    right->collect_reads(reads);
+  }
+
   protected:
   int evaluate_as_int() const override {
     return left->evaluate_as_int() - right->evaluate_as_int();
@@ -116,6 +149,16 @@ class MulExpr: public Expr {
   MulExpr(Expr* left, Expr* right) : left(left), right(right),
                                      Expr(choose_type(left, right)) {}
 
+  ~MulExpr() {
+    delete left;
+    delete right;
+  }
+
+  void collect_reads(vector<const Variable *> &reads) const override {
+    left->collect_reads(reads);
+    right->collect_reads(reads);
+  }
+
   protected:
   int evaluate_as_int() const override {
     int left_value = left->evaluate_as_int();
@@ -142,12 +185,23 @@ class DivExpr: public Expr {
   DivExpr(Expr* left, Expr* right) : left(left), right(right),
                                      Expr(choose_type(left, right)) {}
 
+  ~DivExpr() {
+    delete left;
+    delete right;
+  }
+
+  void collect_reads(vector<const Variable *> &reads) const override {
+    left->collect_reads(reads);
+    right->collect_reads(reads);
+  }
+
   protected:
   int evaluate_as_int() const override {
     int left_value = left->evaluate_as_int();
     int right_value = right->evaluate_as_int();
     if (right_value == 0) {
-      throw RuntimeError("Divded by zero");
+      fail(ErrorCode::DividedByZero);
+      return 0;
     }
     return left_value / right_value;
   }
@@ -156,7 +210,8 @@ class DivExpr: public Expr {
     double left_value = left->evaluate_and_promote_to_double();
     double right_value = right->evaluate_and_promote_to_double();
     if (is_zero(right_value)) {
-      throw RuntimeError("Divded by zero");
+      fail(ErrorCode::DividedByZero);
+      return 0.0;
     }
     return left_value / right_value;
   }
@@ -169,17 +224,29 @@ class PowExpr: public Expr {
   public:
   PowExpr(Expr* left, Expr* right) : left(left), right(right),
                                      Expr(Type::Double) {}
+
+  ~PowExpr() {
+    delete left;
+    delete right;
+  }
+
+  void collect_reads(vector<const Variable *> &reads) const override {
+    left->collect_reads(reads);
+    right->collect_reads(reads);
+  }
+
   protected:
   int evaluate_as_int() const override {
-    throw RuntimeError("Cannot evaluate pow expression as int.");
+    fail(ErrorCode::PowAsInt);
+    return 0;
   }
 
   double evaluate_as_double() const override {
     double left_value = left->evaluate_and_promote_to_double();
     double right_value = right->evaluate_and_promote_to_double();
     if (left_value < 0 && !is_zero(right_value - round(right_value))) {
-      throw RuntimeError(
-          "Cannot calculate non-integer power of negative value");
+      fail(ErrorCode::NonIntegerPowerOfNegative);
+      return 0.0;
     }
     return pow(left_value, right_value);
   }
@@ -190,6 +257,14 @@ class WavExpr: public Expr {
   public:
   WavExpr(Expr* expr) : expr(expr), Expr(Type::Int) {}
 
+  ~WavExpr() {
+    delete expr;
+  }
+
+  void collect_reads(vector<const Variable *> &reads) const override {
+    expr->collect_reads(reads);
+  }
+
   protected:
   int evaluate_as_int() const override {
     if (expr->type() == Type::Int) {
@@ -199,17 +274,15 @@ class WavExpr: public Expr {
   }
 
   double evaluate_as_double() const override {
-    throw RuntimeError("Cannot evaluate wave expression as double.");
+    fail(ErrorCode::WavAsDouble);
+    return 0.0;
   }
 };
 
-vector<char> op_stack;
-vector<Expr*> num_stack;
-
 /**
  * Process the last operator in the stack.
  */
-void process_last_operator() {
+void ExprParser::process_last_operator() {
   // Special case for unary operators.
   if (op_stack.back() == '~') {
     op_stack.pop_back();
@@ -244,9 +317,9 @@ void process_last_operator() {
       result = new PowExpr(left_operand, right_operand);
       break;
     default:
-      THROW_ERROR_FORMAT(
-          std::logic_error,
-          "Unexpected operator %c",
+      THROW_ERROR(
+          InternalError,
+          ErrorCode::UnknownOperator,
           op_stack.back());
   }
   // Remove the processed operator from stack;
@@ -260,19 +333,39 @@ bool is_unary_operator(int type) {
   return type == '~';
 }
 
+// Literals that are out of range are still operands, so that they are
+// reported as such rather than as misplaced tokens.
+bool is_literal(int type) {
+  return type == INTEGER_LITERAL || type == DOUBLE_LITERAL
+    || type == OVERFLOW_LEXEME;
+}
+
+// Frees what is left on the stacks when parsing stops, which only happens on
+// an error, as the parsed expression is popped before it is returned.
 class stack_releaser {
   public:
+  stack_releaser(vector<char> &op_stack, vector<Expr*> &num_stack)
+    : op_stack(op_stack), num_stack(num_stack) {}
+
   ~stack_releaser() {
+    for (Expr *e : num_stack) {
+      delete e;
+    }
     num_stack.clear();
     op_stack.clear();
   }
+
+  private:
+  vector<char> &op_stack;
+  vector<Expr*> &num_stack;
 };
 
-Expr* parse_arith_expr(token (*lexer)(), Program *p) {
-  stack_releaser releaser;
-  token t;
+Expr* ExprParser::parse_arith_expr(TokenBuffer &tokens, Program *p) {
+  stack_releaser releaser(op_stack, num_stack);
+  size_t i;
+  int type;
   bool expecting_number = true;
-  while (t = lexer(), t.type != ';' && t.type) {
+  while (i = tokens.next(), type = tokens.type(i), type != ';' && type) {
     // There are two states when parsing the expression, one is when we expects
     // an operand in the next input, the other is when we expects an operator.
     //
@@ -284,21 +377,30 @@ Expr* parse_arith_expr(token (*lexer)(), Program *p) {
     // The situation can be more complicated if we decide to support suffix
     // uniary operators, e.g. factorial operator `!`.
     if (expecting_number ^
-          (t.type == INTEGER_LITERAL || t.type == IDENTIFIER || t.type == '('
-           || is_unary_operator(t.type))) {
-      THROW_ERROR_FORMAT_LINE(
+          (is_literal(type) || type == IDENTIFIER || type == '('
+           || is_unary_operator(type))) {
+      THROW_ERROR_LINE(
           CompilingError,
-          t,
-          "Consecutive numbers or operators found: %d",
-          t.type);
+          ErrorCode::ConsecutiveOperands,
+          tokens.position(i),
+          type);
     }
     expecting_number =
-      !(t.type == INTEGER_LITERAL || t.type == IDENTIFIER || t.type == ')');
+      !(is_literal(type) || type == IDENTIFIER || type == ')');
 
-    switch (t.type) {
+    switch (type) {
       case INTEGER_LITERAL:
-        num_stack.push_back(new Num(t.int_val));
+        num_stack.push_back(new Num(tokens.int_val(i)));
         break;
+      case DOUBLE_LITERAL:
+        num_stack.push_back(new Num(tokens.double_val(i)));
+        break;
+      case OVERFLOW_LEXEME:
+        THROW_ERROR_LINE(
+            CompilingError,
+            ErrorCode::NumberOutOfRange,
+            tokens.position(i),
+            tokens.str_val(i));
       case IDENTIFIER:
         {
           /**
@@ -314,7 +416,7 @@ Expr* parse_arith_expr(token (*lexer)(), Program *p) {
       case '(':
       case '~':
         // Do nothing.
-        op_stack.push_back(t.ops_val);
+        op_stack.push_back(tokens.ops_val(i));
         break;
       case '^':
         // Power operator has the highest priority.
@@ -322,7 +424,7 @@ Expr* parse_arith_expr(token (*lexer)(), Program *p) {
             (op_stack.back() == '^' || op_stack.back() == '~')) {
           process_last_operator();
         }
-        op_stack.push_back(t.ops_val);
+        op_stack.push_back(tokens.ops_val(i));
         break;
       case '*':
       case '/':
@@ -332,7 +434,7 @@ Expr* parse_arith_expr(token (*lexer)(), Program *p) {
              || op_stack.back() == '/' || op_stack.back() == '~')) {
           process_last_operator();
         }
-        op_stack.push_back(t.ops_val);
+        op_stack.push_back(tokens.ops_val(i));
         break;
       case '+':
       case '-':
@@ -343,7 +445,7 @@ Expr* parse_arith_expr(token (*lexer)(), Program *p) {
                || op_stack.back() == '-' || op_stack.back() == '~')) {
           process_last_operator();
         }
-        op_stack.push_back(t.ops_val);
+        op_stack.push_back(tokens.ops_val(i));
         break;
       case ')':
         while (!op_stack.empty() && op_stack.back() != '(') {
@@ -351,17 +453,17 @@ Expr* parse_arith_expr(token (*lexer)(), Program *p) {
         }
         if (op_stack.empty()) {
           // Error: expecting parenthesis but not getting one.
-          throw CompilingError("Unmatched right parenthesis in input");
+          THROW_ERROR(CompilingError, ErrorCode::UnmatchedRightParenthesis);
         }
         // Remove '('
         op_stack.pop_back();
         break;
       default:
-        THROW_ERROR_FORMAT_LINE(
+        THROW_ERROR_LINE(
             CompilingError,
-            t,
-            "Unexpected token with type %d",
-            t.type);
+            ErrorCode::UnexpectedToken,
+            tokens.position(i),
+            type);
     }
   }
 
@@ -371,13 +473,13 @@ Expr* parse_arith_expr(token (*lexer)(), Program *p) {
       // Returning to caller for a better error message.
       return nullptr;
     }
-    throw CompilingError("Missing operand");
+    THROW_ERROR(CompilingError, ErrorCode::MissingOperand);
   }
 
   // Process all remaining operators in the stack.
   while (!op_stack.empty()) {
     if (op_stack.back() == '(') {
-      throw CompilingError("Unmatched left parenthesis in input");
+      THROW_ERROR(CompilingError, ErrorCode::UnmatchedLeftParenthesis);
     }
     process_last_operator();
   }
@@ -1,8 +1,49 @@
 #ifndef ARITH_EXPR_H
 #define ARITH_EXPR_H
 #include <stdexcept>
+#include <vector>
+#include "diagnostic.h"
 
 class Program;
+class TokenBuffer;
+class Variable;
+class Expr;
+
+/**
+ * Evaluating an expression never throws. When a runtime error happens, e.g. a
+ * division by zero, the error is recorded in `eval_status` and a dummy value
+ * is returned instead. Only the first error is kept. Whoever evaluates a whole
+ * expression, usually a statement, checks the status afterwards and decides
+ * how the error should be reported.
+ *
+ * Runtime errors used to be exceptions, which are very expensive when thrown.
+ * Checking a flag once per statement costs almost nothing.
+ */
+struct EvalStatus {
+  bool failed;
+  ErrorCode code;
+  // Throws each error right away as a `RuntimeError` instead, as it used to
+  // be. Only kept to compare with, see `make bench_errors`.
+  bool throwing;
+
+  void fail(ErrorCode code) {
+    if (throwing) {
+      throw_error(code);
+    }
+    if (!failed) {
+      this->failed = true;
+      this->code = code;
+    }
+  }
+
+  void clear() {
+    failed = false;
+  }
+
+  [[noreturn]] static void throw_error(ErrorCode code);
+};
+
+extern thread_local EvalStatus eval_status;
 
 class Expr {
   static const double esp;
@@ -40,6 +81,10 @@ class Expr {
     return evaluate_as_int();
   }
 
+  // Appends the variables read by the expression, in no particular order and
+  // possibly more than once.
+  virtual void collect_reads(std::vector<const Variable *> &) const {}
+
   virtual ~Expr() {}
 
   protected:
@@ -53,6 +98,11 @@ class Expr {
 
   static bool is_zero(double value);
 
+  // Records a runtime error, see `EvalStatus`.
+  void fail(ErrorCode code) const {
+    eval_status.fail(code);
+  }
+
   friend class AddExpr;
   friend class SubExpr;
   friend class MulExpr;
@@ -61,6 +111,22 @@ class Expr {
   friend class WavExpr;
 };
 
-Expr* parse_arith_expr(token (*lexer)(), Program *p);
+/**
+ * Operator precedence parser for expressions. The operator and operand stacks
+ * belong to the parser rather than being globals, so several programs can be
+ * compiled at once on different threads, each with a parser of its own. A
+ * parser is reused for every expression of a program, which also keeps the
+ * memory of its stacks.
+ */
+class ExprParser {
+  public:
+  Expr* parse_arith_expr(TokenBuffer &tokens, Program *p);
+
+  private:
+  std::vector<char> op_stack;
+  std::vector<Expr*> num_stack;
+
+  void process_last_operator();
+};
 
 #endif
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "batch.h"
+#include "interpreter.h"
+#include "lexer.h"
+#include "output.h"
+#include "token_buffer.h"
+#include "work_stealing_pool.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+bool list_programs(const char *source, vector<string> &paths) {
+  struct stat st;
+  if (stat(source, &st) != 0) {
+    return false;
+  }
+  if (S_ISDIR(st.st_mode)) {
+    DIR *dir = opendir(source);
+    if (dir == nullptr) {
+      return false;
+    }
+    size_t first = paths.size();
+    while (struct dirent *entry = readdir(dir)) {
+      string path = string(source) + "/" + entry->d_name;
+      if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        paths.push_back(path);
+      }
+    }
+    closedir(dir);
+    // Directories are listed in no particular order.
+    std::sort(paths.begin() + first, paths.end());
+    return true;
+  }
+
+  FILE *list = fopen(source, "r");
+  if (list == nullptr) {
+    return false;
+  }
+  char line[4096];
+  while (fgets(line, sizeof(line), list) != nullptr) {
+    size_t length = strcspn(line, "\r\n");
+    if (length > 0) {
+      paths.emplace_back(line, length);
+    }
+  }
+  fclose(list);
+  return true;
+}
+
+unique_ptr<Program> compile_program(const string &path, Output &out) {
+  lexer_scanner *scanner = lexer_open_file(path.c_str());
+  if (scanner == nullptr) {
+    out.print_error("Cannot read program: ", strerror(errno));
+    return nullptr;
+  }
+  unique_ptr<Program> p;
+  {
+    TokenBuffer tokens(scanner);
+    try {
+      p = parse_program(tokens);
+    } catch (const CompilingError &e) {
+      out.print_error("Compiling error: ", e.what());
+    } catch (const std::exception &e) {
+      // An `InternalError`, or `bad_alloc`, fails only this program.
+      out.print_error("Internal error: ", e.what());
+    }
+  }
+  // Runtime errors have no position, so the input is no longer needed.
+  lexer_close(scanner);
+  return p;
+}
+
+bool read_program(const string &path, string &source, Output &out) {
+  FILE *file = fopen(path.c_str(), "r");
+  if (file == nullptr) {
+    out.print_error("Cannot read program: ", strerror(errno));
+    return false;
+  }
+  char block[64 * 1024];
+  size_t n;
+  while ((n = fread(block, 1, sizeof(block), file)) > 0) {
+    source.append(block, n);
+  }
+  bool ok = !ferror(file);
+  if (!ok) {
+    out.print_error("Cannot read program: ", strerror(errno));
+  }
+  fclose(file);
+  return ok;
+}
+
+// Like `compile_program()` then `Program::run()`, but through the cache.
+static bool run_cached(const string &path, ProgramCache &cache, Output &out) {
+  string source;
+  if (!read_program(path, source, out)) {
+    return false;
+  }
+  try {
+    std::shared_ptr<const Program> p = cache.get(source);
+    Frame frame(p->variable_count());
+    p->run(out, frame);
+  } catch (const CompilingError &e) {
+    out.print_error("Compiling error: ", e.what());
+    return false;
+  } catch (const RuntimeError &e) {
+    out.print_error("Runtime error: ", e.what());
+    return false;
+  } catch (const std::exception &e) {
+    out.print_error("Internal error: ", e.what());
+    return false;
+  }
+  return true;
+}
+
+string output_file_name(const string &path, const char *output_dir) {
+  const char *slash = strrchr(path.c_str(), '/');
+  return string(output_dir) + "/"
+    + (slash != nullptr ? slash + 1 : path.c_str()) + ".out";
+}
+
+bool check_output_names(const vector<string> &paths, const char *output_dir) {
+  if (output_dir == nullptr) {
+    return true;
+  }
+  std::map<string, const string *> programs;
+  for (const string &path : paths) {
+    auto inserted = programs.emplace(output_file_name(path, output_dir), &path);
+    if (!inserted.second) {
+      fprintf(stderr, "%s and %s would both write %s\n",
+          inserted.first->second->c_str(), path.c_str(),
+          inserted.first->first.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+ProgramOutput::ProgramOutput(const string &path, const char *output_dir,
+    Output::Format format)
+  : path(path), memory(nullptr) {
+  if (output_dir == nullptr) {
+    memory = new MemorySink();
+    out.reset(new Output(unique_ptr<Sink>(memory), format));
+    return;
+  }
+  string name = output_file_name(path, output_dir);
+  FILE *file = fopen(name.c_str(), "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Cannot write %s: %s\n", name.c_str(), strerror(errno));
+    return;
+  }
+  out.reset(new Output(unique_ptr<Sink>(new FileSink(file, true))));
+  out->set_format(format);
+}
+
+void ProgramOutput::commit() {
+  // Serializes the programs appending to the combined output.
+  static std::mutex output_mutex;
+  if (memory == nullptr) {
+    return;
+  }
+  out->flush();
+  std::lock_guard<std::mutex> lock(output_mutex);
+  ::output.print_program(path.c_str());
+  ::output.append(memory->text().data(), memory->text().size());
+}
+
+// Compiles and runs one program of a batch. Returns false if it failed.
+static bool run_one(const string &path, const char *output_dir,
+    Output::Format format, ProgramCache *cache) {
+  ProgramOutput program_output(path, output_dir, format);
+  if (!program_output.ok()) {
+    return false;
+  }
+  Output &out = program_output.output();
+  bool ok;
+  if (cache != nullptr) {
+    ok = run_cached(path, *cache, out);
+  } else {
+    unique_ptr<Program> p = compile_program(path, out);
+    ok = p != nullptr;
+    if (ok) {
+      try {
+        p->run(out);
+      } catch (const RuntimeError &e) {
+        out.print_error("Runtime error: ", e.what());
+        ok = false;
+      } catch (const std::exception &e) {
+        // E.g. `std::logic_error` from `Variable::assign()`.
+        out.print_error("Internal error: ", e.what());
+        ok = false;
+      }
+    }
+  }
+  program_output.commit();
+  return ok;
+}
+
+int run_batch(const char *source, int jobs, const char *output_dir,
+    ProgramCache *cache) {
+  vector<string> paths;
+  if (!list_programs(source, paths)) {
+    fprintf(stderr, "Cannot read %s: %s\n", source, strerror(errno));
+    return -1;
+  }
+  if (!check_output_names(paths, output_dir)) {
+    return -1;
+  }
+
+  Output::Format format = output.current_format();
+  std::atomic<bool> failed(false);
+  WorkStealingPool pool(jobs < 1 ? 1 : jobs);
+  for (const string &path : paths) {
+    pool.submit([&, format]() {
+      // Tasks must not throw, see `WorkStealingPool`. Errors of a program
+      // are caught below, so this only catches running out of memory
+      // around them.
+      try {
+        if (!run_one(path, output_dir, format, cache)) {
+          failed = true;
+        }
+      } catch (const std::exception &e) {
+        fprintf(stderr, "Cannot run %s: %s\n", path.c_str(), e.what());
+        failed = true;
+      }
+    });
+  }
+  pool.wait();
+  return failed ? -1 : 0;
+}
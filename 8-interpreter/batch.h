@@ -0,0 +1,82 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include <memory>
+#include <string>
+#include <vector>
+#include "interpreter.h"
+#include "output.h"
+#include "program_cache.h"
+
+/**
+ * Compiles and runs many program files in one process, instead of starting
+ * an interpreter per program. `source` is either a directory, whose regular
+ * files are the programs, or a file listing the path of a program per line.
+ *
+ * Programs run on a work-stealing pool of `jobs` threads, each with its own
+ * lexer, parser, variables and output. With `output_dir`, the output of a
+ * program, errors included, goes to a file named after the program with
+ * `.out` appended in that directory, see `output_file_name()`. A batch with
+ * two programs of the same name, in different directories of a list, is
+ * rejected before anything runs, rather than having one output overwrite
+ * the other. Otherwise the outputs are combined into
+ * the interpreter's output, whole, in the order the programs finish, each
+ * after a `print_program()` tag.
+ *
+ * With a cache, programs with the same source are compiled once, and their
+ * runs share the compiled program.
+ *
+ * An error of one program, including an internal error of the interpreter,
+ * is reported in its output and does not stop the others.
+ *
+ * Returns 0 if every program ran without error.
+ */
+int run_batch(const char *source, int jobs, const char *output_dir,
+    ProgramCache *cache = nullptr);
+
+// Adds the programs of `source` to `paths`, see `run_batch()`. Returns false
+// if it cannot be read.
+bool list_programs(const char *source, std::vector<std::string> &paths);
+
+// The file in `output_dir` that the output of the program at `path` goes to:
+// its file name with `.out` appended.
+std::string output_file_name(const std::string &path, const char *output_dir);
+
+// Returns false, after reporting two of them to stderr, if several of `paths`
+// would write the same file in `output_dir`. Always true without one.
+bool check_output_names(const std::vector<std::string> &paths,
+    const char *output_dir);
+
+// Returns null, after writing the error to `out`, if the program cannot be
+// read or compiled.
+std::unique_ptr<Program> compile_program(const std::string &path, Output &out);
+
+// Returns false, after writing the error to `out`, if the file cannot be read.
+bool read_program(const std::string &path, std::string &source, Output &out);
+
+// Where the output of a program of a batch goes, see `run_batch()`.
+class ProgramOutput {
+  public:
+  ProgramOutput(const std::string &path, const char *output_dir,
+      Output::Format format);
+
+  // False if the output file cannot be written, which is reported to stderr.
+  bool ok() const {
+    return out != nullptr;
+  }
+
+  Output &output() {
+    return *out;
+  }
+
+  // Appends the output of the program to the interpreter's output, unless it
+  // went to its own file. Can be called from any thread.
+  void commit();
+
+  private:
+  std::string path;
+  // Null when writing to a file.
+  MemorySink *memory;
+  std::unique_ptr<Output> out;
+};
+
+#endif
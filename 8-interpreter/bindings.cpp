@@ -0,0 +1,267 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "batch.h"
+#include "bindings.h"
+#include "interpreter.h"
+#include "number.h"
+#include "output.h"
+#include "thread_pool.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+static bool is_separator(char c) {
+  return c == ' ' || c == '\t' || c == ',' || c == '\r';
+}
+
+static bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static const char *skip_digits(const char *p, const char *end) {
+  while (p < end && is_digit(*p)) {
+    p++;
+  }
+  return p;
+}
+
+// An optional minus sign and decimal digits. Like the literals of a program,
+// the magnitude must fit in an int.
+static bool parse_int_value(const char *p, const char *end, int *value) {
+  bool negative = p < end && *p == '-';
+  p += negative;
+  if (p == end || skip_digits(p, end) != end
+      || parse_int_literal(p, end, value) != 0) {
+    return false;
+  }
+  if (negative) {
+    *value = -*value;
+  }
+  return true;
+}
+
+// An optional minus sign and a literal matched by `double_const` or
+// `int_const` of lexer.lex, see `parse_double_literal()`.
+static bool parse_double_value(const char *p, const char *end,
+    double *value) {
+  bool negative = p < end && *p == '-';
+  p += negative;
+  const char *start = p;
+  p = skip_digits(p, end);
+  size_t digits = p - start;
+  if (p < end && *p == '.') {
+    const char *fraction = ++p;
+    p = skip_digits(p, end);
+    digits += p - fraction;
+  }
+  if (digits == 0) {
+    return false;
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    p++;
+    if (p < end && (*p == '+' || *p == '-')) {
+      p++;
+    }
+    const char *exponent = p;
+    p = skip_digits(p, end);
+    if (p == exponent) {
+      return false;
+    }
+  }
+  if (p != end || parse_double_literal(start, end, value) != 0) {
+    return false;
+  }
+  if (negative) {
+    *value = -*value;
+  }
+  return true;
+}
+
+bool bind_line(const Program &program, const char *begin, const char *end,
+    int line, Frame &frame) {
+  const vector<Program::Input> &inputs = program.inputs();
+  size_t count = 0;
+  const char *p = begin;
+  for (;;) {
+    while (p < end && is_separator(*p)) {
+      p++;
+    }
+    if (p == end) {
+      break;
+    }
+    const char *value_end = p;
+    while (value_end < end && !is_separator(*value_end)) {
+      value_end++;
+    }
+    if (count < inputs.size()) {
+      bool valid;
+      if (inputs[count].var->type() == Expr::Type::Int) {
+        int value;
+        valid = parse_int_value(p, value_end, &value);
+        if (valid) {
+          program.bind(frame, count, value);
+        }
+      } else {
+        double value;
+        valid = parse_double_value(p, value_end, &value);
+        if (valid) {
+          program.bind(frame, count, value);
+        }
+      }
+      if (!valid) {
+        THROW_ERROR_LINE(
+            BindingError,
+            ErrorCode::InvalidInputValue,
+            (Position{line, (int) (p - begin) + 1}),
+            string(p, value_end),
+            inputs[count].name);
+      }
+    }
+    count++;
+    p = value_end;
+  }
+  if (count == 0) {
+    return false;
+  }
+  if (count != inputs.size()) {
+    THROW_ERROR_LINE(
+        BindingError,
+        ErrorCode::WrongInputCount,
+        (Position{line, 1}),
+        (int) inputs.size(),
+        (int) count);
+  }
+  return true;
+}
+
+// Runs the program once per line from `begin` to `end`, the first of which is
+// line `line`, with one frame for all of them.
+static void run_lines_of(const Program &program, const char *begin,
+    const char *end, int line, Output &out) {
+  Frame frame(program.variable_count());
+  while (begin < end) {
+    const char *newline = (const char *) memchr(begin, '\n', end - begin);
+    const char *line_end = newline != nullptr ? newline : end;
+    try {
+      if (bind_line(program, begin, line_end, line, frame)) {
+        program.run(out, frame);
+      }
+    } catch (const BindingError &e) {
+      out.print_error("Binding error: ", e.what());
+    } catch (const RuntimeError &e) {
+      out.print_error("Runtime error: ", e.what());
+    }
+    begin = newline != nullptr ? newline + 1 : end;
+    line++;
+  }
+}
+
+// Lines run together on a worker thread. Their output is kept in memory until
+// all the lines before them have been written, as in `run_lines_parallel()`.
+struct BindingBatch {
+  static const size_t kMaxLines = 4096;
+
+  MemorySink *sink;
+  Output out;
+  std::future<void> done;
+
+  explicit BindingBatch(Output::Format format)
+    : sink(new MemorySink()), out(unique_ptr<Sink>(sink), format) {}
+};
+
+// Runs batches of lines on `jobs` threads, and writes their outputs in order.
+static void run_batches(const Program &program, const char *begin,
+    const char *end, int jobs) {
+  // Declared before the pool, so that the workers are joined before the
+  // batches are freed.
+  std::deque<unique_ptr<BindingBatch>> pending;
+  ThreadPool pool(jobs);
+  // Bounds the memory used when the workers fall behind.
+  const size_t max_pending = 4 * jobs;
+
+  auto write_first = [&pending]() {
+    BindingBatch &batch = *pending.front();
+    batch.done.get();
+    batch.out.flush();
+    output.append(batch.sink->text().data(), batch.sink->text().size());
+    pending.pop_front();
+  };
+  int line = 1;
+  while (begin < end) {
+    // Ends the batch right after its last newline.
+    const char *batch_end = begin;
+    size_t lines = 0;
+    while (batch_end < end && lines < BindingBatch::kMaxLines) {
+      const char *newline = (const char *) memchr(
+          batch_end, '\n', end - batch_end);
+      batch_end = newline != nullptr ? newline + 1 : end;
+      lines++;
+    }
+    BindingBatch *b = new BindingBatch(output.current_format());
+    pending.emplace_back(b);
+    b->done = pool.submit([&program, b, begin, batch_end, line]() {
+      run_lines_of(program, begin, batch_end, line, b->out);
+    });
+    while (pending.size() > max_pending) {
+      write_first();
+    }
+    begin = batch_end;
+    line += lines;
+  }
+  while (!pending.empty()) {
+    write_first();
+  }
+}
+
+int run_bindings(const char *program_path, const char *bindings_path,
+    int jobs) {
+  unique_ptr<Program> p = compile_program(program_path, output);
+  if (p == nullptr) {
+    return -1;
+  }
+  p->number_variables();
+
+  int fd = open(bindings_path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "Cannot read %s: %s\n", bindings_path, strerror(errno));
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+  size_t size = st.st_size;
+  const char *input = nullptr;
+  if (size > 0) {
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      fprintf(stderr, "Cannot read %s: %s\n", bindings_path, strerror(errno));
+      close(fd);
+      return -1;
+    }
+    input = (const char *) mapped;
+    madvise(mapped, size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  if (jobs > 1) {
+    run_batches(*p, input, input + size, jobs);
+  } else {
+    run_lines_of(*p, input, input + size, 1, output);
+  }
+  if (input != nullptr) {
+    munmap((void *) input, size);
+  }
+  return 0;
+}
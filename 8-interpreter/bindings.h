@@ -0,0 +1,42 @@
+#ifndef BINDINGS_H
+#define BINDINGS_H
+#include "diagnostic.h"
+#include "interpreter.h"
+
+/**
+ * Runs the program at `program_path` once per line of the file at
+ * `bindings_path`, with the values on the line bound to the inputs of the
+ * program, see `bind_line()`. The program is compiled once, and each run
+ * only binds the values into a frame and runs it again, see
+ * `Program::run()`. The bindings file is mapped into memory, like a program
+ * file, so it must be a regular file.
+ *
+ * Blank lines are skipped, and are not runs. The outputs of the runs follow
+ * each other, in the order of the lines. An
+ * error in the values of a line, or at runtime, is reported in place of the
+ * rest of the output of that run, and the next line is run, as in `--lines`
+ * mode. With more than one job, batches of lines are run on a pool of
+ * threads, each with a frame of its own, and the output is the same.
+ *
+ * Returns 0 if the program compiled, even if some runs failed.
+ */
+int run_bindings(const char *program_path, const char *bindings_path,
+    int jobs);
+
+// The values of a line do not fit the inputs of the program.
+class BindingError: public Error {
+  public:
+  BindingError(const Diagnostic &diagnostic) : Error(diagnostic) {}
+};
+
+// Binds the values of the text from `begin` to `end`, line `line` of a
+// bindings file, to the inputs of `program` in `frame`, in the order the
+// inputs are declared. Values are separated by blanks or commas, and are
+// decimal numbers with an optional minus sign. An int input only takes an
+// integer. Returns false, binding nothing, if the line is blank, which
+// includes a lone `\r`. Throws `BindingError` if there is not one value per
+// input, or if a value is not valid for its input.
+bool bind_line(const Program &program, const char *begin, const char *end,
+    int line, Frame &frame);
+
+#endif
@@ -0,0 +1,157 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "bindings.h"
+#include "interpreter.h"
+#include "lexer.h"
+#include "token_buffer.h"
+#define RETURN_STR(...) { \
+  error_str r; \
+  r.len = asprintf(&(r.str), __VA_ARGS__); \
+  return r; \
+}
+#define RETURN_SUCCESS { return SUCCESS; }
+#define ASSERT(condition, ...) { \
+  if (!(condition)) { \
+    RETURN_STR(__VA_ARGS__); \
+  } \
+}
+#define RUN_TEST(func) { \
+  printf("Test %s running...\n", #func); \
+  error_str r = func(); \
+  if (r.len != 0) { \
+    printf("Test %s failed: %s\n", #func, r.str); \
+  } else { \
+    printf("Test %s passed.\n", #func); \
+  } \
+}
+
+typedef struct error_str {
+  int len;
+  char *str;
+} error_str;
+const error_str SUCCESS = {0, NULL};
+
+// Declaring inputs needs no homework, as long as they are not read.
+const char *INPUTS = "input int n\ninput double x\n";
+
+std::unique_ptr<Program> compile(const char *source) {
+  lexer_scanner *scanner = lexer_open_buffer(source, strlen(source));
+  std::unique_ptr<Program> p;
+  {
+    TokenBuffer tokens(scanner);
+    p = parse_program(tokens);
+  }
+  lexer_close(scanner);
+  p->number_variables();
+  return p;
+}
+
+// Binds `text` as line 1, and returns the error message, or an empty string.
+std::string bind(const Program &p, const char *text, Frame &frame,
+    bool *bound = nullptr) {
+  try {
+    bool b = bind_line(p, text, text + strlen(text), 1, frame);
+    if (bound != nullptr) {
+      *bound = b;
+    }
+  } catch (const BindingError &e) {
+    return e.what();
+  }
+  return "";
+}
+
+int int_input(const Program &p, const Frame &frame, size_t input) {
+  return frame[p.inputs()[input].var->slot()].int_val;
+}
+
+double double_input(const Program &p, const Frame &frame, size_t input) {
+  return frame[p.inputs()[input].var->slot()].double_val;
+}
+
+error_str test_separators() {
+  std::unique_ptr<Program> p = compile(INPUTS);
+  Frame frame(p->variable_count());
+  const char *lines[] = {"3 0.5", "3,0.5", "  3 ,\t0.5 ", "3, 0.5\r"};
+  for (const char *line : lines) {
+    std::string error = bind(*p, line, frame);
+    ASSERT(error.empty(), "Unexpected error %s for '%s'.", error.c_str(),
+        line);
+    ASSERT(int_input(*p, frame, 0) == 3 && double_input(*p, frame, 1) == 0.5,
+        "Expecting 3 and 0.5 for '%s'.", line);
+    frame[p->inputs()[0].var->slot()].int_val = 0;
+  }
+  RETURN_SUCCESS;
+}
+
+error_str test_values() {
+  std::unique_ptr<Program> p = compile(INPUTS);
+  Frame frame(p->variable_count());
+  std::string error = bind(*p, "-7 -1.25e2", frame);
+  ASSERT(error.empty(), "Unexpected error %s.", error.c_str());
+  ASSERT(int_input(*p, frame, 0) == -7 && double_input(*p, frame, 1) == -125,
+      "Expecting -7 and -125.");
+  // An integer is a valid double.
+  error = bind(*p, "2147483647 4", frame);
+  ASSERT(error.empty(), "Unexpected error %s.", error.c_str());
+  ASSERT(int_input(*p, frame, 0) == 2147483647
+      && double_input(*p, frame, 1) == 4.0, "Expecting INT_MAX and 4.");
+  error = bind(*p, "0 .5", frame);
+  ASSERT(error.empty() && double_input(*p, frame, 1) == 0.5,
+      "Expecting .5 to be valid.");
+  RETURN_SUCCESS;
+}
+
+error_str test_invalid_values() {
+  std::unique_ptr<Program> p = compile(INPUTS);
+  Frame frame(p->variable_count());
+  const char *lines[] = {
+    "1.5 1", "- 1", "--1 1", "+1 1", "2147483648 1", "x 1",
+    "1 -", "1 1e", "1 .", "1 1e309", "1 nan", "1 1.5x",
+  };
+  for (const char *line : lines) {
+    std::string error = bind(*p, line, frame);
+    ASSERT(error.find("Invalid value") == 0,
+        "Expecting an invalid value for '%s' but got '%s'.", line,
+        error.c_str());
+  }
+  std::string error = bind(*p, "1 1e309", frame);
+  ASSERT(error == "Invalid value 1e309 for input x at line 1, column 3.",
+      "Unexpected message %s", error.c_str());
+  RETURN_SUCCESS;
+}
+
+error_str test_input_count() {
+  std::unique_ptr<Program> p = compile(INPUTS);
+  Frame frame(p->variable_count());
+  std::string error = bind(*p, "1", frame);
+  ASSERT(error == "Expecting 2 input values but got 1 at line 1, column 1.",
+      "Unexpected message %s", error.c_str());
+  error = bind(*p, "1 2 3", frame);
+  ASSERT(error == "Expecting 2 input values but got 3 at line 1, column 1.",
+      "Unexpected message %s", error.c_str());
+  RETURN_SUCCESS;
+}
+
+error_str test_blank_lines() {
+  std::unique_ptr<Program> p = compile(INPUTS);
+  Frame frame(p->variable_count());
+  const char *lines[] = {"", " \t", "\r", " , "};
+  for (const char *line : lines) {
+    bool bound = true;
+    std::string error = bind(*p, line, frame, &bound);
+    ASSERT(error.empty() && !bound, "Expecting a blank line for '%s'.", line);
+  }
+  RETURN_SUCCESS;
+}
+
+int main() {
+  RUN_TEST(test_separators);
+  RUN_TEST(test_values);
+  RUN_TEST(test_invalid_values);
+  RUN_TEST(test_input_count);
+  RUN_TEST(test_blank_lines);
+  return 0;
+}
@@ -0,0 +1,22 @@
+/**
+ * Prints the 64-bit FNV-1a hash and the length of stdin, in the same format as
+ * `interpreter --checksum`. Usage: checksum < expected-output.txt
+ */
+#include <stdio.h>
+#include <stdint.h>
+
+int main() {
+  unsigned char buffer[64 * 1024];
+  uint64_t hash = UINT64_C(0xcbf29ce484222325);
+  uint64_t length = 0;
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      hash = (hash ^ buffer[i]) * UINT64_C(0x100000001b3);
+    }
+    length += n;
+  }
+  printf("%016llx %llu\n", (unsigned long long) hash,
+      (unsigned long long) length);
+  return 0;
+}
@@ -0,0 +1,249 @@
+#ifndef DIAGNOSTIC_H
+#define DIAGNOSTIC_H
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+/**
+ * Every error the interpreter can report has a code. The human readable
+ * message for each code lives in `Diagnostic::message_format()`.
+ */
+enum class ErrorCode {
+  // Compiling errors.
+  ConsecutiveOperands,
+  UnexpectedToken,
+  UnmatchedRightParenthesis,
+  UnmatchedLeftParenthesis,
+  MissingOperand,
+  VariableDoesNotExist,
+  UnexpectedKeyword,
+  UnexpectedOperator,
+  ExpectingAssignedExpression,
+  ExpectingPrintedExpression,
+  UndefinedVariable,
+  UnrecognizedInput,
+  NumberOutOfRange,
+  ExpectingInputDeclaration,
+  InputAlreadyDefined,
+
+  // Runtime errors.
+  DividedByZero,
+  NonIntegerPowerOfNegative,
+  NumAsInt,
+  PowAsInt,
+  WavAsDouble,
+  UninitializedVariable,
+  VariableAsInt,
+  VariableAsDouble,
+
+  // Errors in the values bound to the inputs of a program.
+  WrongInputCount,
+  InvalidInputValue,
+
+  // Problems with the interpreter itself.
+  UnknownOperator,
+  UnknownExprValueType,
+  UnknownValueType,
+  UnrecognizedTokenType,
+};
+
+// Where a token starts in the source.
+struct Position {
+  int line;
+  int column;
+};
+
+/**
+ * A diagnostic records what went wrong, but not the message itself. The error
+ * code, the position and the arguments are stored in a fixed size structure,
+ * so that creating one never allocates memory. The message is only formatted
+ * when somebody asks for it, usually right before it is printed.
+ */
+class Diagnostic {
+  public:
+  static const int kMaxArgs = 3;
+  static const int kMaxStringLength = 64;
+
+  ErrorCode code;
+  // Position of the offending token. Zero if there is no position.
+  int line;
+  int column;
+
+  template <typename... Args>
+  Diagnostic(ErrorCode code, const Args &... args)
+    : code(code), line(0), column(0), argc(0) {
+    add_args(args...);
+  }
+
+  Diagnostic &at(Position position) {
+    this->line = position.line;
+    this->column = position.column;
+    return *this;
+  }
+
+  Diagnostic &arg(int value) {
+    Arg &a = next_arg();
+    a.kind = 'd';
+    a.int_val = value;
+    return *this;
+  }
+
+  Diagnostic &arg(char value) {
+    Arg &a = next_arg();
+    a.kind = 'c';
+    a.char_val = value;
+    return *this;
+  }
+
+  // Strings are copied, as they usually do not outlive the throw site.
+  // Strings that are too long are truncated.
+  Diagnostic &arg(const char *value) {
+    Arg &a = next_arg();
+    a.kind = 's';
+    strncpy(a.str_val, value, kMaxStringLength - 1);
+    a.str_val[kMaxStringLength - 1] = '\0';
+    return *this;
+  }
+
+  Diagnostic &arg(const std::string &value) {
+    return arg(value.c_str());
+  }
+
+  // Writes the message into `buffer`. The message is truncated if the buffer
+  // is too small.
+  void format(char *buffer, size_t size) const {
+    if (size == 0) {
+      return;
+    }
+    const char *f = message_format(code);
+    char *p = buffer;
+    char *end = buffer + size - 1;
+    int next = 0;
+    while (*f && p < end) {
+      if (*f != '%' || next >= argc) {
+        *p++ = *f++;
+        continue;
+      }
+      // Skip the conversion, the argument knows its own type.
+      f += 2;
+      const Arg &a = args[next++];
+      switch (a.kind) {
+        case 'd':
+          p += snprintf(p, end - p + 1, "%d", a.int_val);
+          break;
+        case 'c':
+          *p++ = a.char_val;
+          break;
+        case 's':
+          p += snprintf(p, end - p + 1, "%s", a.str_val);
+          break;
+      }
+      if (p > end) {
+        p = end;
+      }
+    }
+    if (line > 0 && p < end) {
+      p += snprintf(p, end - p + 1, " at line %d, column %d.", line, column);
+      if (p > end) {
+        p = end;
+      }
+    }
+    *p = '\0';
+  }
+
+  static const char *message_format(ErrorCode code) {
+    switch (code) {
+      case ErrorCode::ConsecutiveOperands:
+        return "Consecutive numbers or operators found: %d";
+      case ErrorCode::UnexpectedToken:
+        return "Unexpected token with type %d";
+      case ErrorCode::UnmatchedRightParenthesis:
+        return "Unmatched right parenthesis in input";
+      case ErrorCode::UnmatchedLeftParenthesis:
+        return "Unmatched left parenthesis in input";
+      case ErrorCode::MissingOperand:
+        return "Missing operand";
+      case ErrorCode::VariableDoesNotExist:
+        return "Variable %s does not exist.";
+      case ErrorCode::UnexpectedKeyword:
+        return "Unexpected keyword %s";
+      case ErrorCode::UnexpectedOperator:
+        return "Unexpected operator %c";
+      case ErrorCode::ExpectingAssignedExpression:
+        return "Excpeting an expression to assign to variable %s";
+      case ErrorCode::ExpectingPrintedExpression:
+        return "Excpeting an expression to print";
+      case ErrorCode::UndefinedVariable:
+        return "Undefined variable %s";
+      case ErrorCode::UnrecognizedInput:
+        return "Unrecognized input %c";
+      case ErrorCode::NumberOutOfRange:
+        return "Number %s is out of range";
+      case ErrorCode::ExpectingInputDeclaration:
+        return "Expecting only a type and a variable name after input";
+      case ErrorCode::InputAlreadyDefined:
+        return "Variable %s is already defined";
+      case ErrorCode::DividedByZero:
+        return "Divded by zero";
+      case ErrorCode::NonIntegerPowerOfNegative:
+        return "Cannot calculate non-integer power of negative value";
+      case ErrorCode::NumAsInt:
+        return "Cannot evaluate num as int.";
+      case ErrorCode::PowAsInt:
+        return "Cannot evaluate pow expression as int.";
+      case ErrorCode::WavAsDouble:
+        return "Cannot evaluate wave expression as double.";
+      case ErrorCode::UninitializedVariable:
+        return "Evaluating uninitialized variable.";
+      case ErrorCode::VariableAsInt:
+        return "Referencing non-int value as int.";
+      case ErrorCode::VariableAsDouble:
+        return "Referencing non-double value as double.";
+      case ErrorCode::WrongInputCount:
+        return "Expecting %d input values but got %d";
+      case ErrorCode::InvalidInputValue:
+        return "Invalid value %s for input %s";
+      case ErrorCode::UnknownOperator:
+        return "Unexpected operator %c";
+      case ErrorCode::UnknownExprValueType:
+        return "Unknown expr value type %d";
+      case ErrorCode::UnknownValueType:
+        return "Unknown value type %d";
+      case ErrorCode::UnrecognizedTokenType:
+        return "Unrecognized token type %d";
+    }
+    return "Unknown error";
+  }
+
+  private:
+  struct Arg {
+    char kind;
+    union {
+      int int_val;
+      char char_val;
+      char str_val[kMaxStringLength];
+    };
+  };
+
+  int argc;
+  Arg args[kMaxArgs];
+
+  void add_args() {}
+
+  template <typename T, typename... Rest>
+  void add_args(const T &first, const Rest &... rest) {
+    arg(first);
+    add_args(rest...);
+  }
+
+  Arg &next_arg() {
+    // Extra arguments overwrite the last one. There is no message that needs
+    // more than `kMaxArgs` arguments.
+    if (argc < kMaxArgs) {
+      argc++;
+    }
+    return args[argc - 1];
+  }
+};
+
+#endif
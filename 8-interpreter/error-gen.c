@@ -0,0 +1,38 @@
+/**
+ * Generates input for `interpreter --lines` in which a large share of the
+ * lines fail at runtime. Usage: error-gen [lines] [error percentage]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#define N 1000000
+#define ERROR_RATE 50
+#define N_OPS 4
+
+const char ops[] = "+-*/";
+
+void gen_expr(int l) {
+  printf("%d", rand() % 100 + 1);
+  for (int i = 0; i < l; i++) {
+    printf("%c%d", ops[rand() % N_OPS], rand() % 100 + 1);
+  }
+}
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : N;
+  int error_rate = argc > 2 ? atoi(argv[2]) : ERROR_RATE;
+  // No srand, on purpose.
+  for (int i = 0; i < n; i++) {
+    gen_expr(rand() % 4);
+    if (rand() % 100 < error_rate) {
+      if (rand() % 2) {
+        printf("/(0*(");
+        gen_expr(1);
+        printf("))");
+      } else {
+        printf("+(0-2)^(1/2)");
+      }
+    }
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,194 @@
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include "interp.h"
+#include "interpreter.h"
+#include "lexer.h"
+#include "output.h"
+#include "token_buffer.h"
+
+using std::string;
+
+// Writes into the buffer of the caller, counting what does not fit.
+class BufferSink: public Sink {
+  char *buffer;
+  size_t capacity;
+  size_t length;
+
+  public:
+  BufferSink() : buffer(nullptr), capacity(0), length(0) {}
+
+  void reset(char *buffer, size_t capacity) {
+    this->buffer = buffer;
+    this->capacity = capacity;
+    length = 0;
+  }
+
+  size_t written() const {
+    return length;
+  }
+
+  void write(const char *data, size_t size) override {
+    if (length < capacity) {
+      memcpy(buffer + length, data, size < capacity - length
+          ? size : capacity - length);
+    }
+    length += size;
+  }
+};
+
+struct interp_program {
+  std::unique_ptr<Program> program;
+};
+
+struct interp_state {
+  const Program *program;
+  Frame frame;
+  BufferSink *sink;
+  Output out;
+  string error;
+
+  explicit interp_state(const Program *program)
+    : program(program), frame(program->variable_count()),
+      sink(new BufferSink()), out(std::unique_ptr<Sink>(sink)) {}
+};
+
+static void copy_error(const char *message, char *error, size_t error_size) {
+  if (error != nullptr && error_size > 0) {
+    strncpy(error, message, error_size - 1);
+    error[error_size - 1] = '\0';
+  }
+}
+
+interp_program *interp_compile(const char *source, size_t size, char *error,
+    size_t error_size) {
+  if (source == nullptr) {
+    copy_error("No program source", error, error_size);
+    return nullptr;
+  }
+  try {
+    lexer_scanner *scanner = lexer_open_buffer(source, size);
+    if (scanner == nullptr) {
+      throw std::bad_alloc();
+    }
+    std::unique_ptr<Program> p;
+    try {
+      TokenBuffer tokens(scanner);
+      p = parse_program(tokens);
+    } catch (...) {
+      lexer_close(scanner);
+      throw;
+    }
+    lexer_close(scanner);
+    p->number_variables();
+    interp_program *program = new interp_program();
+    program->program = std::move(p);
+    return program;
+  } catch (const std::exception &e) {
+    copy_error(e.what(), error, error_size);
+    return nullptr;
+  }
+}
+
+void interp_program_free(interp_program *program) {
+  delete program;
+}
+
+interp_state *interp_state_new(const interp_program *program) {
+  if (program == nullptr) {
+    return nullptr;
+  }
+  try {
+    return new interp_state(program->program.get());
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void interp_state_free(interp_state *state) {
+  delete state;
+}
+
+int interp_run(interp_state *state, char *output, size_t output_size,
+    size_t *output_length) {
+  if (state == nullptr || (output == nullptr && output_size > 0)) {
+    return INTERP_INVALID_ARGUMENT;
+  }
+  state->sink->reset(output, output_size);
+  state->error.clear();
+  int status = INTERP_OK;
+  try {
+    state->program->run(state->out, state->frame);
+  } catch (const RuntimeError &e) {
+    state->error = e.what();
+    status = INTERP_RUNTIME_ERROR;
+  } catch (const std::exception &e) {
+    state->error = e.what();
+    status = INTERP_INTERNAL_ERROR;
+  }
+  state->out.flush();
+  if (output_length != nullptr) {
+    *output_length = state->sink->written();
+  }
+  return status;
+}
+
+size_t interp_input_count(const interp_program *program) {
+  if (program == nullptr) {
+    return 0;
+  }
+  return program->program->inputs().size();
+}
+
+const char *interp_input_name(const interp_program *program, size_t index) {
+  if (program == nullptr) {
+    return nullptr;
+  }
+  const std::vector<Program::Input> &inputs = program->program->inputs();
+  return index < inputs.size() ? inputs[index].name.c_str() : nullptr;
+}
+
+int interp_set_input(interp_state *state, size_t index,
+    const interp_value *value) {
+  if (state == nullptr || value == nullptr) {
+    return INTERP_INVALID_ARGUMENT;
+  }
+  if (index >= state->program->inputs().size()) {
+    return INTERP_NO_VARIABLE;
+  }
+  if (value->type == INTERP_INT) {
+    state->program->bind(state->frame, index, value->int_val);
+  } else {
+    state->program->bind(state->frame, index, value->double_val);
+  }
+  return INTERP_OK;
+}
+
+const char *interp_error(const interp_state *state) {
+  if (state == nullptr) {
+    return "";
+  }
+  return state->error.c_str();
+}
+
+int interp_get_variable(const interp_state *state, const char *name,
+    interp_value *value) {
+  if (state == nullptr || name == nullptr || value == nullptr) {
+    return INTERP_INVALID_ARGUMENT;
+  }
+  const Variable *var = state->program->find_variable(name);
+  if (var == nullptr) {
+    return INTERP_NO_VARIABLE;
+  }
+  const VariableValue &stored = state->frame[var->slot()];
+  if (var->type() == Expr::Type::Int) {
+    value->type = INTERP_INT;
+    value->int_val = stored.int_val;
+  } else {
+    value->type = INTERP_DOUBLE;
+    value->double_val = stored.double_val;
+  }
+  return INTERP_OK;
+}
@@ -0,0 +1,106 @@
+#ifndef INTERP_H
+#define INTERP_H
+#include <stddef.h>
+
+/**
+ * C API of the interpreter, for embedding it in other programs. Link with
+ * libinterp.a or libinterp.so, and the C++ runtime.
+ *
+ * A program is compiled once from memory, and can then be run any number of
+ * times, by any number of threads at once. Each run needs a state, which
+ * holds the values of the variables of the program and must only be used by
+ * one thread at a time. Nothing is written to stdout or stderr.
+ *
+ * Null pointers are rejected rather than dereferenced: functions returning a
+ * pointer return NULL, and functions returning a status return
+ * `INTERP_INVALID_ARGUMENT`.
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct interp_program interp_program;
+typedef struct interp_state interp_state;
+
+enum interp_status {
+  INTERP_OK = 0,
+  INTERP_COMPILING_ERROR,
+  INTERP_RUNTIME_ERROR,
+  // A bug of the interpreter, or a lack of memory.
+  INTERP_INTERNAL_ERROR,
+  // The program has no variable of this name, or no input of this number.
+  INTERP_NO_VARIABLE,
+  // A null pointer was passed where one is required.
+  INTERP_INVALID_ARGUMENT,
+};
+
+enum interp_type {
+  INTERP_INT,
+  INTERP_DOUBLE,
+};
+
+typedef struct interp_value {
+  enum interp_type type;
+  union {
+    int int_val;
+    double double_val;
+  };
+} interp_value;
+
+// Compiles the `size` bytes of program text at `source`. Returns NULL if the
+// program does not compile, or if `source` is NULL, after writing the message
+// to `error`, unless it is NULL, truncated to `error_size` bytes including
+// the terminating NUL.
+interp_program *interp_compile(const char *source, size_t size, char *error,
+    size_t error_size);
+
+// The states of the program must be freed first. Does nothing for NULL.
+void interp_program_free(interp_program *program);
+
+// Returns NULL if `program` is NULL, or if memory runs out.
+interp_state *interp_state_new(const interp_program *program);
+
+// Does nothing for NULL.
+void interp_state_free(interp_state *state);
+
+// Runs the program with the variables of `state`, and returns an
+// `interp_status`. The printed values are written to `output`, as the text
+// printed by `interpreter`, up to `output_size` bytes with no terminating NUL.
+// Like `snprintf()`, `output_length` is set to the length of the whole
+// output, even when more than `output_size`. On error the values printed
+// before the error are kept, and the message is returned by `interp_error()`.
+// `output` may only be NULL if `output_size` is 0.
+int interp_run(interp_state *state, char *output, size_t output_size,
+    size_t *output_length);
+
+// The message of the error of the last run, or an empty string, also when
+// `state` is NULL.
+const char *interp_error(const interp_state *state);
+
+// The inputs of a program, declared by `input int x` or `input double x`, are
+// numbered from 0 in the order they are declared. The program is compiled
+// once, and then run with new values for its inputs each time.
+// Returns 0 for NULL.
+size_t interp_input_count(const interp_program *program);
+
+// Returns the name of input `index`, or NULL if there is no such input, or if
+// `program` is NULL.
+const char *interp_input_name(const interp_program *program, size_t index);
+
+// Gives input `index` a value for the runs with `state`. It keeps the value
+// until given another one, or until the program assigns to it. An int is
+// converted for a double input, and a double is truncated for an int input.
+// Reading an input that was never given a value is a runtime error.
+int interp_set_input(interp_state *state, size_t index,
+    const interp_value *value);
+
+// Reads a variable as the last run left it. Variables that were not assigned
+// by a run read as zero.
+int interp_get_variable(const interp_state *state, const char *name,
+    interp_value *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,295 @@
+// For asprintf().
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include "interp.h"
+#define RETURN_STR(...) { \
+  error_str r; \
+  r.len = asprintf(&(r.str), __VA_ARGS__); \
+  return r; \
+}
+#define RETURN_SUCCESS { return SUCCESS; }
+#define RUN_TEST(func) { \
+  printf("Test %s running...\n", #func); \
+  error_str r = func(); \
+  if (r.len != 0) { \
+    printf("Test %s failed: %s\n", #func, r.str); \
+  } else { \
+    printf("Test %s passed.\n", #func); \
+  } \
+}
+
+// Only prints, so that it compiles before the variable homework is done.
+char *PROGRAM = "print 1 + 2\nprint 3 / 2.0\n";
+// Needs the variable homework of interpreter.cpp and arith_expr.cpp.
+char *VARIABLES = "int a = 1 + 2\nprint a * 2\ndouble b = a / 2.0\nprint b\n";
+
+typedef struct error_str {
+  int len;
+  char *str;
+} error_str;
+const error_str SUCCESS = {0, NULL};
+
+error_str test_run() {
+  char output[64];
+  size_t length;
+  interp_program *program = interp_compile(PROGRAM, strlen(PROGRAM), NULL, 0);
+  if (program == NULL) {
+    RETURN_STR("Expecting the program to compile.");
+  }
+  interp_state *state = interp_state_new(program);
+  if (state == NULL) {
+    RETURN_STR("Expecting a state.");
+  }
+  // Runs twice, as a program can be run any number of times.
+  for (int i = 0; i < 2; i++) {
+    int status = interp_run(state, output, sizeof(output), &length);
+    if (status != INTERP_OK) {
+      RETURN_STR("Expecting no error but got %d: %s", status,
+          interp_error(state));
+    }
+    if (length != 10 || memcmp(output, "3.00\n1.50\n", length) != 0) {
+      RETURN_STR("Unexpected output %.*s", (int) length, output);
+    }
+  }
+  interp_state_free(state);
+  interp_program_free(program);
+  RETURN_SUCCESS;
+}
+
+error_str test_variables() {
+  char output[64];
+  size_t length;
+  interp_value value;
+  interp_program *program = interp_compile(VARIABLES, strlen(VARIABLES),
+      NULL, 0);
+  if (program == NULL) {
+    printf("Test test_variables skipped, the variable homework is not done.\n");
+    RETURN_SUCCESS;
+  }
+  interp_state *state = interp_state_new(program);
+  if (state == NULL) {
+    RETURN_STR("Expecting a state.");
+  }
+  if (interp_run(state, output, sizeof(output), &length) != INTERP_OK
+      || length != 10 || memcmp(output, "6.00\n1.50\n", length) != 0) {
+    RETURN_STR("Unexpected output %.*s", (int) length, output);
+  }
+  if (interp_get_variable(state, "a", &value) != INTERP_OK
+      || value.type != INTERP_INT || value.int_val != 3) {
+    RETURN_STR("Expecting a to be 3.");
+  }
+  if (interp_get_variable(state, "b", &value) != INTERP_OK
+      || value.type != INTERP_DOUBLE || value.double_val != 1.5) {
+    RETURN_STR("Expecting b to be 1.5.");
+  }
+  interp_state_free(state);
+  interp_program_free(program);
+  RETURN_SUCCESS;
+}
+
+error_str test_truncated_output() {
+  char output[5] = "xxxx";
+  size_t length;
+  interp_program *program = interp_compile(PROGRAM, strlen(PROGRAM), NULL, 0);
+  interp_state *state = interp_state_new(program);
+  if (state == NULL) {
+    RETURN_STR("Expecting the program to compile.");
+  }
+  interp_run(state, output, 3, &length);
+  if (length != 10 || memcmp(output, "3.0x", 4) != 0) {
+    RETURN_STR("Expecting 3 of 10 bytes but got %zu: %.4s", length, output);
+  }
+  interp_state_free(state);
+  interp_program_free(program);
+  RETURN_SUCCESS;
+}
+
+error_str test_compiling_error() {
+  char error[16];
+  const char *source = "print ;\n";
+  if (interp_compile(source, strlen(source), error, sizeof(error)) != NULL) {
+    RETURN_STR("Expecting a compiling error.");
+  }
+  if (strlen(error) != sizeof(error) - 1) {
+    RETURN_STR("Expecting a truncated message but got %s", error);
+  }
+  RETURN_SUCCESS;
+}
+
+error_str test_runtime_error() {
+  char output[64];
+  size_t length;
+  const char *source = "print 1\nprint 1 / 0\nprint 2\n";
+  interp_program *program = interp_compile(source, strlen(source), NULL, 0);
+  interp_state *state = interp_state_new(program);
+  if (state == NULL) {
+    RETURN_STR("Expecting the program to compile.");
+  }
+  int status = interp_run(state, output, sizeof(output), &length);
+  if (status != INTERP_RUNTIME_ERROR || strlen(interp_error(state)) == 0) {
+    RETURN_STR("Expecting a runtime error but got %d.", status);
+  }
+  if (length != 5 || memcmp(output, "1.00\n", length) != 0) {
+    RETURN_STR("Unexpected output %.*s", (int) length, output);
+  }
+  interp_state_free(state);
+  interp_program_free(program);
+  RETURN_SUCCESS;
+}
+
+error_str test_null_arguments() {
+  char output[8];
+  size_t length;
+  interp_value value;
+  char error[64];
+  if (interp_compile(NULL, 1, error, sizeof(error)) != NULL) {
+    RETURN_STR("Expecting no program without a source.");
+  }
+  if (interp_state_new(NULL) != NULL) {
+    RETURN_STR("Expecting no state without a program.");
+  }
+  if (interp_run(NULL, output, sizeof(output), &length)
+      != INTERP_INVALID_ARGUMENT) {
+    RETURN_STR("Expecting an invalid argument for no state.");
+  }
+  if (interp_get_variable(NULL, "a", &value) != INTERP_INVALID_ARGUMENT) {
+    RETURN_STR("Expecting an invalid argument for no state.");
+  }
+  if (strcmp(interp_error(NULL), "") != 0) {
+    RETURN_STR("Expecting no error for no state.");
+  }
+  interp_program *program = interp_compile(PROGRAM, strlen(PROGRAM), NULL, 0);
+  interp_state *state = interp_state_new(program);
+  if (state == NULL) {
+    RETURN_STR("Expecting the program to compile.");
+  }
+  if (interp_run(state, NULL, 1, &length) != INTERP_INVALID_ARGUMENT) {
+    RETURN_STR("Expecting an invalid argument for no output.");
+  }
+  // Only counts the output.
+  if (interp_run(state, NULL, 0, &length) != INTERP_OK || length != 10) {
+    RETURN_STR("Expecting 10 bytes of output but got %zu.", length);
+  }
+  if (interp_get_variable(state, NULL, &value) != INTERP_INVALID_ARGUMENT) {
+    RETURN_STR("Expecting an invalid argument for no name.");
+  }
+  if (interp_get_variable(state, "c", &value) != INTERP_NO_VARIABLE) {
+    RETURN_STR("Expecting no variable c.");
+  }
+  interp_state_free(state);
+  interp_program_free(program);
+  interp_state_free(NULL);
+  interp_program_free(NULL);
+  RETURN_SUCCESS;
+}
+
+error_str test_inputs() {
+  size_t length;
+  interp_value value;
+  // Declares inputs without reading them, which needs no homework.
+  const char *source = "input int n\ninput double x\n";
+  interp_program *program = interp_compile(source, strlen(source), NULL, 0);
+  if (program == NULL || interp_input_count(program) != 2
+      || strcmp(interp_input_name(program, 1), "x") != 0
+      || interp_input_name(program, 2) != NULL) {
+    RETURN_STR("Expecting inputs n and x.");
+  }
+  interp_state *state = interp_state_new(program);
+  if (state == NULL) {
+    RETURN_STR("Expecting a state.");
+  }
+  value.type = INTERP_DOUBLE;
+  value.double_val = 2.75;
+  // Truncated for the int input.
+  interp_set_input(state, 0, &value);
+  interp_set_input(state, 1, &value);
+  if (interp_run(state, NULL, 0, &length) != INTERP_OK || length != 0) {
+    RETURN_STR("Expecting no output and no error.");
+  }
+  if (interp_get_variable(state, "n", &value) != INTERP_OK
+      || value.type != INTERP_INT || value.int_val != 2) {
+    RETURN_STR("Expecting n to be 2.");
+  }
+  if (interp_get_variable(state, "x", &value) != INTERP_OK
+      || value.type != INTERP_DOUBLE || value.double_val != 2.75) {
+    RETURN_STR("Expecting x to be 2.75.");
+  }
+  if (interp_set_input(state, 2, &value) != INTERP_NO_VARIABLE
+      || interp_set_input(state, 0, NULL) != INTERP_INVALID_ARGUMENT
+      || interp_set_input(NULL, 0, &value) != INTERP_INVALID_ARGUMENT
+      || interp_input_count(NULL) != 0 || interp_input_name(NULL, 0) != NULL) {
+    RETURN_STR("Expecting bad inputs to be rejected.");
+  }
+  interp_state_free(state);
+  interp_program_free(program);
+  RETURN_SUCCESS;
+}
+
+// Until the homework is done, an expression reading a variable may not even
+// parse safely, so tests reading variables check for it first. `VARIABLES`
+// only fails to compile without it.
+int homework_done() {
+  interp_program *program = interp_compile(VARIABLES, strlen(VARIABLES),
+      NULL, 0);
+  int done = program != NULL;
+  interp_program_free(program);
+  return done;
+}
+
+error_str test_reading_inputs() {
+  char output[64];
+  size_t length;
+  interp_value value;
+  if (!homework_done()) {
+    printf("Test test_reading_inputs skipped, the variable homework is not "
+        "done.\n");
+    RETURN_SUCCESS;
+  }
+  const char *source = "input int n\ninput double x\nprint n * x\n";
+  interp_program *program = interp_compile(source, strlen(source), NULL, 0);
+  if (program == NULL) {
+    RETURN_STR("Expecting the program to compile.");
+  }
+  interp_state *state = interp_state_new(program);
+  if (state == NULL) {
+    RETURN_STR("Expecting a state.");
+  }
+  if (interp_run(state, output, sizeof(output), &length)
+      != INTERP_RUNTIME_ERROR) {
+    RETURN_STR("Expecting an error for inputs without values.");
+  }
+  value.type = INTERP_INT;
+  value.int_val = 2;
+  interp_set_input(state, 0, &value);
+  value.type = INTERP_DOUBLE;
+  value.double_val = 1.5;
+  interp_set_input(state, 1, &value);
+  interp_run(state, output, sizeof(output), &length);
+  if (length != 5 || memcmp(output, "3.00\n", length) != 0) {
+    RETURN_STR("Unexpected output %.*s", (int) length, output);
+  }
+  // Only n changes, x keeps its value.
+  value.type = INTERP_INT;
+  value.int_val = 4;
+  interp_set_input(state, 0, &value);
+  interp_run(state, output, sizeof(output), &length);
+  if (length != 5 || memcmp(output, "6.00\n", length) != 0) {
+    RETURN_STR("Unexpected output %.*s", (int) length, output);
+  }
+  interp_state_free(state);
+  interp_program_free(program);
+  RETURN_SUCCESS;
+}
+
+int main() {
+  RUN_TEST(test_run);
+  RUN_TEST(test_variables);
+  RUN_TEST(test_truncated_output);
+  RUN_TEST(test_compiling_error);
+  RUN_TEST(test_runtime_error);
+  RUN_TEST(test_null_arguments);
+  RUN_TEST(test_inputs);
+  RUN_TEST(test_reading_inputs);
+  return 0;
+}
@@ -1,25 +1,44 @@
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <future>
 #include <string>
 #include <memory>
+#include <thread>
+#include <vector>
 #include <stdexcept>
 #include "lexer.h"
+#include "output.h"
+#include "token_buffer.h"
 #include "arith_expr.h"
 #include "interpreter.h"
+#include "thread_pool.h"
 #include "variable.h"
 
 using std::string;
 using std::unique_ptr;
 
+thread_local Frame *current_frame = nullptr;
+
 const Variable &Program::lookup_variable(const string &name) const {
   if (!defined_variable(name)) {
-    throw CompilingError("Variable " + name + " does not exist.");
+    THROW_ERROR(CompilingError, ErrorCode::VariableDoesNotExist, name);
   }
   return variable_map.at(name);
 }
 
+const Variable *Program::find_variable(const string &name) const {
+  auto it = variable_map.find(name);
+  return it == variable_map.end() ? nullptr : &it->second;
+}
+
 Variable &Program::lookup_variable(const string &name) {
   if (!defined_variable(name)) {
-    throw CompilingError("Variable " + name + " does not exist.");
+    THROW_ERROR(CompilingError, ErrorCode::VariableDoesNotExist, name);
   }
   return variable_map.at(name);
 }
@@ -51,22 +70,140 @@ bool Program::defined_variable(const string &name) const {
 Variable &Program::create_variable(const string &name, Expr::Type type) {
 }
 
-void Program::append_statement(const Statement *p) {
-  statements.emplace_back(p);
+// Does not go through `create_variable()`, so that inputs can be declared and
+// bound before the homework above is done.
+Variable &Program::create_input(const string &name, Expr::Type type) {
+  Variable &var = variable_map.emplace(name, type).first->second;
+  var.set_input();
+  inputs_.push_back(Input{name, &var});
+  return var;
+}
+
+void Program::bind(Frame &frame, size_t input, int value) const {
+  const Variable &var = *inputs_[input].var;
+  VariableValue &stored = frame[var.slot()];
+  if (var.type() == Expr::Type::Int) {
+    stored.int_val = value;
+  } else {
+    stored.double_val = value;
+  }
+  stored.initialized = true;
+}
+
+void Program::bind(Frame &frame, size_t input, double value) const {
+  const Variable &var = *inputs_[input].var;
+  VariableValue &stored = frame[var.slot()];
+  if (var.type() == Expr::Type::Int) {
+    stored.int_val = value;
+  } else {
+    stored.double_val = value;
+  }
+  stored.initialized = true;
+}
+
+Program::~Program() {
+  if (queue != nullptr) {
+    queue->close();
+    queue->wait_empty();
+  }
+}
+
+void Program::append_assignment(const Expr *expr, Variable &var) {
+  if (streaming && queue != nullptr) {
+    // The variable is reset by the thread running the statement.
+    enqueue(Statement(expr, var, statement_count++));
+    return;
+  }
+  if (streaming) {
+    // There is no `run()` to reset the variable before it is first used.
+    var.reset();
+    run_streaming(Statement(expr, var, statement_count++));
+    return;
+  }
+  statements.emplace_back(expr, var, statement_count++);
+}
+
+void Program::append_print(const Expr *expr) {
+  if (streaming && queue != nullptr) {
+    enqueue(Statement(expr, statement_count++));
+    return;
+  }
+  if (streaming) {
+    run_streaming(Statement(expr, statement_count++));
+    return;
+  }
+  statements.emplace_back(expr, statement_count++);
+}
+
+void Program::run_streaming(const Statement &st) {
+  if (!st.run(output)) {
+    THROW_ERROR(RuntimeError, eval_status.code);
+  }
+  // The statement and its expression are released by our caller.
+}
+
+// Thrown to stop parsing when the statements are no longer run, see
+// `run_pipelined()`.
+struct PipelineStopped {};
+
+void Program::enqueue(Statement &&st) {
+  if (!queue->push(std::move(st))) {
+    throw PipelineStopped();
+  }
+}
+
+void Program::run(Output &out) {
+  start();
+  run_some(out, statements.size());
+}
+
+size_t Program::number_variables() {
+  uint32_t slot = 0;
+  for (Input &input: inputs_) {
+    input.var->set_slot(slot++);
+  }
+  for (auto &pair: variable_map) {
+    if (!pair.second.is_input()) {
+      pair.second.set_slot(slot++);
+    }
+  }
+  return slot;
+}
+
+void Program::run(Output &out, Frame &frame) const {
+  FrameScope scope(frame);
+  frame.reset(inputs_.size());
+  eval_status.clear();
+  for (const Statement &st: statements) {
+    if (!st.run(out)) {
+      THROW_ERROR(RuntimeError, eval_status.code);
+    }
+  }
 }
 
-void Program::run() {
+void Program::start() {
   for (auto &pair: variable_map) {
     pair.second.reset();
   }
-  for (const auto &st: statements) {
-    st->run();
+  next_statement = 0;
+}
+
+bool Program::run_some(Output &out, size_t count) {
+  // Another program may have failed on this thread since our last call.
+  eval_status.clear();
+  size_t end = std::min(next_statement + count, statements.size());
+  for (; next_statement != end; next_statement++) {
+    if (!statements[next_statement].run(out)) {
+      // Runtime errors are fatal for a program.
+      THROW_ERROR(RuntimeError, eval_status.code);
+    }
   }
+  return next_statement != statements.size();
 }
 
-void Assignment::run() const {
+bool Statement::run_assignment() const {
   // Unpacking.
-  switch (var.type()) {
+  switch (var->type()) {
     case Expr::Type::Int:
       {
         int x;
@@ -77,33 +214,61 @@ void Assignment::run() const {
           case Expr::Type::Double:
             // Should be truncating.
             x = expr->evaluate_to_double();
+            break;
           default:
-            THROW_ERROR_FORMAT(
-                std::logic_error,
-                "Unknown expr value type %d",
-                (int) var.type());
+            THROW_ERROR(
+                InternalError,
+                ErrorCode::UnknownExprValueType,
+                (int) var->type());
+        }
+        if (eval_status.failed) {
+          return false;
         }
-        var.assign(x);
+        var->assign(x);
         break;
       }
     case Expr::Type::Double:
       {
-        var.assign(expr->evaluate_and_promote_to_double());
+        double x = expr->evaluate_and_promote_to_double();
+        if (eval_status.failed) {
+          return false;
+        }
+        var->assign(x);
         break;
       }
     default:
-      THROW_ERROR_FORMAT(
-          std::logic_error,
-          "Unknown value type %d",
-          (int) var.type());
+      THROW_ERROR(
+          InternalError,
+          ErrorCode::UnknownValueType,
+          (int) var->type());
+  }
+  return true;
+}
+
+bool Statement::run_print(Output &out) const {
+  Value value;
+  if (!evaluate_print(&value)) {
+    return false;
+  }
+  print(value, out);
+  return true;
+}
+
+bool Statement::evaluate_print(Value *value) const {
+  value->type = expr->type();
+  if (value->type == Expr::Type::Int) {
+    value->int_val = expr->evaluate_to_int();
+  } else {
+    value->double_val = expr->evaluate_to_double();
   }
+  return !eval_status.failed;
 }
 
-void PrintStatement::run() const {
-  if (expr->type() == Expr::Type::Int) {
-    printf("%d\n", expr->evaluate_to_int());
+void Statement::print(const Value &value, Output &out) const {
+  if (value.type == Expr::Type::Int) {
+    out.print_int(value.int_val, index);
   } else {
-    printf("%.2lf\n", expr->evaluate_to_double());
+    out.print_double(value.double_val, index);
   }
 }
 
@@ -115,23 +280,28 @@ enum class State {
   Print,
 };
 
-unique_ptr<Program> parse_program() {
-  unique_ptr<Program> p(new Program());
+unique_ptr<Program> parse_program(TokenBuffer &tokens, bool streaming,
+    StatementQueue *queue) {
+  unique_ptr<Program> p(new Program(streaming || queue != nullptr, queue));
+  ExprParser parser;
   string idt;
   Expr::Type type_decl;
-  State state;
-  token t;
-  while ((t=lexer(), t.type)) {
-    switch (t.type) {
+  State state = State::Start;
+  size_t i;
+  int type;
+  while ((i = tokens.next(), type = tokens.type(i))) {
+    // Indices are only valid until the next token is read. The position is
+    // only looked up if there is an error.
+    long offset = tokens.offset(i);
+    switch (type) {
       case K_INTEGER_TYPE:
         {
           if (state != State::Start) {
-            THROW_ERROR_FORMAT(
+            THROW_ERROR_LINE(
                 CompilingError,
-                "Unexpected keyword %s at line %d, column %d.",
-                t.str_val,
-                t.line,
-                t.column);
+                ErrorCode::UnexpectedKeyword,
+                tokens.position_at(offset),
+                tokens.str_val(i));
           }
           state = State::TypeDecl;
           type_decl = Expr::Type::Int;
@@ -140,12 +310,11 @@ unique_ptr<Program> parse_program() {
       case K_DOUBLE_TYPE:
         {
           if (state != State::Start) {
-            THROW_ERROR_FORMAT(
+            THROW_ERROR_LINE(
                 CompilingError,
-                "Unexpected keyword %s at line %d, column %d.",
-                t.str_val,
-                t.line,
-                t.column);
+                ErrorCode::UnexpectedKeyword,
+                tokens.position_at(offset),
+                tokens.str_val(i));
           }
           state = State::TypeDecl;
           type_decl = Expr::Type::Double;
@@ -175,68 +344,115 @@ unique_ptr<Program> parse_program() {
              * The assignment case can be used as reference.
              */
           } else if (state == State::Assign) {
-            Expr *e = parse_arith_expr(lexer, p.get());
+            Expr *e = parser.parse_arith_expr(tokens, p.get());
             if (e == nullptr) {
-              THROW_ERROR_FORMAT(
+              THROW_ERROR_LINE(
                   CompilingError,
-                  "Excpeting an expression to assign to variable %s at line %d, column %d.",
-                  idt.c_str(),
-                  t.line,
-                  t.column);
+                  ErrorCode::ExpectingAssignedExpression,
+                  tokens.position_at(offset),
+                  idt);
             }
             if (!p->defined_variable(idt)) {
-              THROW_ERROR_FORMAT(
+              delete e;
+              THROW_ERROR_LINE(
                   CompilingError,
-                  "Undefined variable %s at line %d, column %d.",
-                  idt.c_str(),
-                  t.line,
-                  t.column);
+                  ErrorCode::UndefinedVariable,
+                  tokens.position_at(offset),
+                  idt);
             }
             Variable &var(p->lookup_variable(idt));
-            p->append_statement(new Assignment(std::move(idt), e, var));
+            p->append_assignment(e, var);
             state = State::Start;
           } else {
-            THROW_ERROR_FORMAT(
+            THROW_ERROR_LINE(
                 CompilingError,
-                "Unexpected operator %c = at line %d, column %d.",
-                t.ops_val,
-                t.line,
-                t.column);
+                ErrorCode::UnexpectedOperator,
+                tokens.position_at(offset),
+                tokens.ops_val(i));
           }
         }
         break;
+      case K_INPUT:
+        {
+          if (state != State::Start) {
+            THROW_ERROR_LINE(
+                CompilingError,
+                ErrorCode::UnexpectedKeyword,
+                tokens.position_at(offset),
+                "input");
+          }
+          // `input`, a type and a name, with no initial value, then the end of
+          // the statement.
+          i = tokens.next();
+          Expr::Type input_type;
+          if (tokens.type(i) == K_INTEGER_TYPE) {
+            input_type = Expr::Type::Int;
+          } else if (tokens.type(i) == K_DOUBLE_TYPE) {
+            input_type = Expr::Type::Double;
+          } else {
+            THROW_ERROR_LINE(
+                CompilingError,
+                ErrorCode::ExpectingInputDeclaration,
+                tokens.position(i));
+          }
+          i = tokens.next();
+          if (tokens.type(i) != IDENTIFIER) {
+            THROW_ERROR_LINE(
+                CompilingError,
+                ErrorCode::ExpectingInputDeclaration,
+                tokens.position(i));
+          }
+          string name(tokens.str_val(i));
+          if (p->find_variable(name) != nullptr) {
+            THROW_ERROR_LINE(
+                CompilingError,
+                ErrorCode::InputAlreadyDefined,
+                tokens.position(i),
+                name);
+          }
+          i = tokens.next();
+          if (tokens.type(i) != ';' && tokens.type(i) != 0) {
+            THROW_ERROR_LINE(
+                CompilingError,
+                ErrorCode::ExpectingInputDeclaration,
+                tokens.position(i));
+          }
+          p->create_input(name, input_type);
+        }
+        break;
       case K_PRINT:
         {
           if (state != State::Start) {
-            THROW_ERROR_FORMAT(
+            THROW_ERROR_LINE(
                 CompilingError,
-                "Unexpected keyword print at line %d, column %d.",
-                t.line,
-                t.column);
+                ErrorCode::UnexpectedKeyword,
+                tokens.position_at(offset),
+                "print");
           }
-          Expr *e = parse_arith_expr(lexer, p.get());
+          Expr *e = parser.parse_arith_expr(tokens, p.get());
           if (e == nullptr) {
-            THROW_ERROR_FORMAT(
+            THROW_ERROR_LINE(
                 CompilingError,
-                "Excpeting an expression to print at line %d, column %d.",
-                t.line,
-                t.column);
+                ErrorCode::ExpectingPrintedExpression,
+                tokens.position_at(offset));
           }
-          p->append_statement(new PrintStatement(e));
+          p->append_print(e);
           state = State::Start;
         }
         break;
       case ERROR_LEXEME:
-        THROW_ERROR_FORMAT(
+        THROW_ERROR_LINE(
             CompilingError,
-            "Unrecognized input %c at line %d column %d.",
-            t.err_val, t.line, t.column);
+            ErrorCode::UnrecognizedInput,
+            tokens.position_at(offset),
+            tokens.err_val(i));
       default:
-        // Throwing logic_error since this is a problem with the compiler.
-        THROW_ERROR_FORMAT(
-            std::logic_error,
-            "Unrecognized token type %d at line %d column %d.",
-            t.type, t.line, t.column);
+        // Throwing InternalError since this is a problem with the compiler.
+        THROW_ERROR_LINE(
+            InternalError,
+            ErrorCode::UnrecognizedTokenType,
+            tokens.position_at(offset),
+            type);
         break;
     }
   }
@@ -244,17 +460,223 @@ unique_ptr<Program> parse_program() {
   return p;
 }
 
-int main() {
+// Runs one line of expression-per-line mode. A runtime error is reported in
+// place of the value, and does not stop the interpreter.
+static void run_line(const Statement &st, Output &out) {
+  bool ok;
+  try {
+    ok = st.run(out);
+  } catch (const RuntimeError &e) {
+    // Only thrown with `EvalStatus::throwing`.
+    out.print_error("Runtime error: ", e.what());
+    return;
+  }
+  if (!ok) {
+    char message[256];
+    Diagnostic(eval_status.code).format(message, sizeof(message));
+    out.print_error("Runtime error: ", message);
+    eval_status.clear();
+  }
+}
+
+/**
+ * Expression-per-line mode, as in 6-interpreter. Each line is an expression
+ * whose value is printed. Compiling errors stop the interpreter, while runtime
+ * errors are reported and the interpreter continues with the next line.
+ */
+int run_lines(TokenBuffer &tokens) {
+  Program p;
+  ExprParser parser;
+  // Each line counts as a statement, empty or not.
+  uint32_t index = 0;
   try {
-    unique_ptr<Program> p = parse_program();
+    do {
+      Expr *e = parser.parse_arith_expr(tokens, &p);
+      if (e == nullptr) {
+        index++;
+        continue;
+      }
+      run_line(Statement(e, index++), output);
+    } while (!tokens.at_end());
+  } catch (const CompilingError &e) {
+    output.print_error("Compiling error: ", e.what());
+    return -1;
+  }
+  return 0;
+}
+
+// Lines parsed together and run on a worker thread. Their output is kept in
+// memory until all the lines before them have been written.
+struct LineBatch {
+  static const size_t kMaxLines = 4096;
+
+  std::vector<Statement> statements;
+  MemorySink *sink;
+  Output out;
+  std::future<void> done;
+
+  explicit LineBatch(Output::Format format)
+    : sink(new MemorySink()), out(unique_ptr<Sink>(sink), format) {}
+};
+
+/**
+ * Expression-per-line mode on several threads. Lines do not depend on each
+ * other, so this thread only parses them, and batches of lines are run by a
+ * pool of workers. Finished batches wait in a reorder buffer until the
+ * batches before them are written, so the output is the same as
+ * `run_lines()`, in the same order.
+ */
+int run_lines_parallel(TokenBuffer &tokens, int jobs) {
+  // Batches submitted to the pool, in the order of the input. Declared before
+  // the pool, so that the workers are joined before the batches are freed.
+  std::deque<unique_ptr<LineBatch>> pending;
+  ThreadPool pool(jobs);
+  // Bounds the memory used when the workers fall behind.
+  const size_t max_pending = 4 * jobs;
+
+  auto write_first = [&pending]() {
+    LineBatch &batch = *pending.front();
+    batch.done.get();
+    batch.out.flush();
+    output.append(batch.sink->text().data(), batch.sink->text().size());
+    pending.pop_front();
+  };
+  unique_ptr<LineBatch> batch(new LineBatch(output.current_format()));
+  auto submit = [&]() {
+    if (batch->statements.empty()) {
+      return;
+    }
+    LineBatch *b = batch.get();
+    b->done = pool.submit([b]() {
+      for (const Statement &st : b->statements) {
+        run_line(st, b->out);
+      }
+    });
+    pending.push_back(std::move(batch));
+    batch.reset(new LineBatch(output.current_format()));
+    while (pending.size() > max_pending) {
+      write_first();
+    }
+  };
 
-    // Parsing finished, now we run the program.
-    p->run();
+  Program p;
+  ExprParser parser;
+  uint32_t index = 0;
+  try {
+    do {
+      Expr *e = parser.parse_arith_expr(tokens, &p);
+      if (e == nullptr) {
+        index++;
+        continue;
+      }
+      batch->statements.emplace_back(e, index++);
+      if (batch->statements.size() == LineBatch::kMaxLines) {
+        submit();
+      }
+    } while (!tokens.at_end());
+  } catch (const CompilingError &e) {
+    // The lines before the error are still run and written first.
+    submit();
+    while (!pending.empty()) {
+      write_first();
+    }
+    output.print_error("Compiling error: ", e.what());
+    return -1;
+  }
+  submit();
+  while (!pending.empty()) {
+    write_first();
+  }
+  return 0;
+}
+
+int run_program(TokenBuffer &tokens, bool streaming, int jobs) {
+  try {
+    unique_ptr<Program> p = parse_program(tokens, streaming);
+
+    // Parsing finished, now we run the program. Nothing is left to run when
+    // streaming.
+    if (jobs > 1) {
+      p->run_parallel(jobs, output);
+    } else {
+      p->run(output);
+    }
+  } catch (const CompilingError &e) {
+    output.print_error("Compiling error: ", e.what());
+    return -1;
+  } catch (const RuntimeError &e) {
+    output.print_error("Runtime error: ", e.what());
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Streaming mode as a pipeline of three threads. One lexes, see
+ * `TokenBuffer::lex_on_thread()`, one parses, and this one runs the
+ * statements, and they hand their work to each other through ring buffers.
+ * Running the first statements overlaps with lexing and parsing the rest, so
+ * a large program takes about as long as its slowest stage. The output and
+ * the errors reported are the same as streaming on one thread.
+ */
+int run_pipelined(TokenBuffer &tokens) {
+  static const size_t kStatementsAhead = 1024;
+  tokens.lex_on_thread();
+  StatementQueue queue(kStatementsAhead);
+  std::exception_ptr parse_error;
+  std::thread parser([&tokens, &queue, &parse_error]() {
+    try {
+      // The program closes the queue when destroyed, even by an exception.
+      parse_program(tokens, true, &queue);
+    } catch (const PipelineStopped &) {
+      // A statement failed, which is reported below.
+    } catch (...) {
+      parse_error = std::current_exception();
+    }
+  });
+
+  bool failed = false;
+  ErrorCode code;
+  std::exception_ptr run_error;
+  for (Statement *st; (st = queue.front()) != nullptr; queue.pop_front()) {
+    if (failed) {
+      // Drains the queue, so that the parser can finish.
+      continue;
+    }
+    st->reset_target();
+    try {
+      if (!st->run(output)) {
+        failed = true;
+        code = eval_status.code;
+        eval_status.clear();
+      }
+    } catch (...) {
+      failed = true;
+      run_error = std::current_exception();
+    }
+    if (failed) {
+      queue.abandon();
+    }
+  }
+  parser.join();
+
+  try {
+    // A failed statement was parsed before any later compiling error.
+    if (run_error) {
+      std::rethrow_exception(run_error);
+    }
+    if (failed) {
+      THROW_ERROR(RuntimeError, code);
+    }
+    if (parse_error) {
+      std::rethrow_exception(parse_error);
+    }
   } catch (const CompilingError &e) {
-    printf("Compiling error: %s\n", e.what());
+    output.print_error("Compiling error: ", e.what());
     return -1;
   } catch (const RuntimeError &e) {
-    printf("Runtime error: %s\n", e.what());
+    output.print_error("Runtime error: ", e.what());
     return -1;
   }
+  return 0;
 }
@@ -1,5 +1,6 @@
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
+#include <cstdint>
 #include <string>
 #include <map>
 #include <vector>
@@ -7,76 +8,245 @@
 #include <memory>
 #include "arith_expr.h"
 #include "variable.h"
+#include "diagnostic.h"
+#include "token_buffer.h"
+#include "spsc_queue.h"
 
-class Statement;
-class Program;
+class Output;
+
+/**
+ * A statement is a small tagged record rather than a class hierarchy. All
+ * statements of a program are stored by value in one contiguous array, so
+ * running a program walks the array linearly without chasing a pointer or
+ * making a virtual call per statement.
+ */
+class Statement {
+  public:
+  enum class Kind {
+    Assignment,
+    Print,
+  };
+
+  // Assigns the value of `expr` to `var`.
+  Statement(const Expr *expr, Variable &var, uint32_t index)
+    : kind(Kind::Assignment), index(index), expr(expr), var(&var) {}
+
+  // Prints the value of `expr`.
+  Statement(const Expr *expr, uint32_t index)
+    : kind(Kind::Print), index(index), expr(expr), var(nullptr) {}
+
+  // The value computed by a print statement, see `evaluate()`.
+  struct Value {
+    Expr::Type type;
+    union {
+      int int_val;
+      double double_val;
+    };
+  };
+
+  // Returns false if a runtime error happened, see `EvalStatus`. Printed
+  // values go to `out`.
+  bool run(Output &out) const {
+    if (kind == Kind::Assignment) {
+      return run_assignment();
+    }
+    return run_print(out);
+  }
+
+  // Like `run()`, except that a print statement only computes its value, which
+  // can be printed later with `print()`.
+  bool evaluate(Value *value) const {
+    if (kind == Kind::Assignment) {
+      return run_assignment();
+    }
+    return evaluate_print(value);
+  }
+
+  void print(const Value &value, Output &out) const;
+
+  bool is_print() const {
+    return kind == Kind::Print;
+  }
+
+  // The assigned variable, or null for print statements.
+  const Variable *target() const {
+    return var;
+  }
+
+  // Marks the assigned variable as initialized, see `Variable::reset()`.
+  void reset_target() const {
+    if (var != nullptr) {
+      var->reset();
+    }
+  }
+
+  void collect_reads(std::vector<const Variable *> &reads) const {
+    expr->collect_reads(reads);
+  }
+
+  private:
+  Kind kind;
+  // Position of the statement in its program, starting from 0. Printed values
+  // are tagged with it in binary output.
+  uint32_t index;
+  std::unique_ptr<const Expr> expr;
+  // The assigned variable. Null for print statements.
+  Variable *var;
+
+  bool run_assignment() const;
+  bool run_print(Output &out) const;
+  bool evaluate_print(Value *value) const;
+};
+
+// Statements on their way from the parser to the thread running them.
+typedef SpscQueue<Statement> StatementQueue;
 
 class Program {
+  public:
+  // An input of the program, declared by `input int x` or `input double x`.
+  struct Input {
+    std::string name;
+    Variable *var;
+  };
+
+  private:
   std::map<std::string, Variable> variable_map;
-  std::vector<std::unique_ptr<const Statement>> statements;
+  // In the order they are declared.
+  std::vector<Input> inputs_;
+  std::vector<Statement> statements;
+  // When streaming, statements are run as soon as they are appended, and are
+  // not kept afterwards.
+  const bool streaming;
+  // Statements appended so far, kept or not.
+  uint32_t statement_count;
+  // If set when streaming, statements are pushed here instead, and run by
+  // another thread.
+  StatementQueue *const queue;
+  // Next statement to run by `run_some()`.
+  size_t next_statement;
+
+  void run_streaming(const Statement &st);
+  void enqueue(Statement &&st);
+
   public:
+  Program(bool streaming = false, StatementQueue *queue = nullptr)
+    : streaming(streaming), statement_count(0), queue(queue),
+      next_statement(0) {}
+
+  // Closes the queue, and waits until the statements in it have run, as they
+  // refer to our variables.
+  ~Program();
+
   const Variable &lookup_variable(const std::string &name) const;
   Variable &lookup_variable(const std::string &name);
   bool defined_variable(const std::string &name) const;
+  // Returns null if there is no such variable.
+  const Variable *find_variable(const std::string &name) const;
   Variable &create_variable(const std::string &name, Expr::Type type);
+  Variable &create_input(const std::string &name, Expr::Type type);
 
-  void append_statement(const Statement *st);
+  const std::vector<Input> &inputs() const {
+    return inputs_;
+  }
 
-  void run();
-};
+  // Gives input number `input` a value for the runs with `frame`, see
+  // `inputs()`. It keeps the value until given another one, or until the
+  // program assigns to it. An int is converted for a double input, and a
+  // double is truncated for an int input, like an assignment.
+  void bind(Frame &frame, size_t input, int value) const;
+  void bind(Frame &frame, size_t input, double value) const;
 
-class Statement {
-  public:
-  virtual void run() const = 0;
-  virtual ~Statement() {}
+  void append_assignment(const Expr *expr, Variable &var);
+  void append_print(const Expr *expr);
+
+  // Printed values go to `out`.
+  void run(Output &out);
+
+  // Numbers the variables for `Frame`s, and returns how many there are. The
+  // inputs come first, in order.
+  size_t number_variables();
+
+  size_t variable_count() const {
+    return variable_map.size();
+  }
+
+  // Runs the program with its variables in `frame`, which has a slot for
+  // each, see `number_variables()`. The program itself is not changed, so
+  // several threads can run it at once, each with a frame of its own. A frame
+  // is reused by binding new inputs to it and running again.
+  void run(Output &out, Frame &frame) const;
+
+  // Runs the program a few statements at a time, so that the thread can do
+  // something else in between: `start()`, then `run_some()` until it returns
+  // false. Runtime errors are thrown like `run()`.
+  void start();
+  bool run_some(Output &out, size_t count);
+
+  // Runs the program on `jobs` threads. Statements that do not depend on each
+  // other run concurrently, see `StatementGraph`, but the output and the
+  // runtime error reported are the same as `run()`.
+  void run_parallel(int jobs, Output &out);
 };
 
-class Assignment: public Statement {
-  const std::string identifier;
-  const std::unique_ptr<const Expr> expr;
-  Variable &var;
+// With a queue, statements are pushed to it as they are parsed, see
+// `Program`, and streaming is implied.
+std::unique_ptr<Program> parse_program(
+    TokenBuffer &tokens, bool streaming = false,
+    StatementQueue *queue = nullptr);
+
+// The modes of `interpreter`, see main.cpp. Each writes to `output`, and
+// returns the exit status.
+int run_lines(TokenBuffer &tokens);
+int run_lines_parallel(TokenBuffer &tokens, int jobs);
+int run_program(TokenBuffer &tokens, bool streaming, int jobs);
+int run_pipelined(TokenBuffer &tokens);
+
+#define THROW_ERROR(error_type, code, ...) \
+  throw error_type(Diagnostic(code, ##__VA_ARGS__))
+
+#define THROW_ERROR_LINE(error_type, code, position, ...) \
+  throw error_type(Diagnostic(code, ##__VA_ARGS__).at(position))
+
+/**
+ * Base class of all errors reported by the interpreter. The message is
+ * formatted from the diagnostic the first time `what()` is called.
+ */
+class Error: public std::exception {
+  Diagnostic diagnostic_;
+  mutable char message[256];
+  mutable bool formatted;
 
   public:
-  Assignment(
-      const std::string &&identifier,
-      const Expr *expr,
-      Variable &var) : identifier(identifier), expr(expr), var(var) {}
+  Error(const Diagnostic &diagnostic)
+    : diagnostic_(diagnostic), formatted(false) {}
 
-  void run() const override;
+  const Diagnostic &diagnostic() const {
+    return diagnostic_;
+  }
+
+  const char *what() const noexcept override {
+    if (!formatted) {
+      diagnostic_.format(message, sizeof(message));
+      formatted = true;
+    }
+    return message;
+  }
 };
 
-class PrintStatement: public Statement {
-  const std::unique_ptr<const Expr> expr;
+class CompilingError: public Error {
   public:
-  PrintStatement(const Expr *expr) : expr(expr) {}
-
-  void run() const override;
+  CompilingError(const Diagnostic &diagnostic) : Error(diagnostic) {}
 };
 
-#define THROW_ERROR_FORMAT(error_type, ...) {\
-  char *error_msg; \
-  asprintf(&error_msg, __VA_ARGS__); \
-  throw error_type(error_msg); \
-}
-
-#define THROW_ERROR_FORMAT_LINE(error_type, token, ...) {\
-  char *error_msg; \
-  asprintf(&error_msg, __VA_ARGS__); \
-  char *error_msg_2; \
-  asprintf(&error_msg_2, "%s at line %d column %d.", error_msg, token.line, token.column); \
-  throw error_type(error_msg_2); \
-}
-
-class CompilingError: public std::logic_error {
+class RuntimeError: public Error {
   public:
-  CompilingError(const std::string &what) : std::logic_error(what) {}
-  CompilingError(const char *what) : std::logic_error(what) {}
+  RuntimeError(const Diagnostic &diagnostic) : Error(diagnostic) {}
 };
 
-class RuntimeError: public std::logic_error {
+// A bug in the interpreter, rather than in the program being interpreted.
+class InternalError: public Error {
   public:
-  RuntimeError(const std::string &what) : std::logic_error(what) {}
-  RuntimeError(const char *what) : std::logic_error(what) {}
+  InternalError(const Diagnostic &diagnostic) : Error(diagnostic) {}
 };
 
 #endif
@@ -1,5 +1,6 @@
 #ifndef LEXER_H
 #define LEXER_H
+#include <stdio.h>
 
 enum token_type {
   // 1 ~ 255 reserved for regular chars.
@@ -10,20 +11,81 @@ enum token_type {
   K_DOUBLE_TYPE,
   K_PRINT,
 
-  ERROR_LEXEME
+  ERROR_LEXEME,
+
+  DOUBLE_LITERAL,
+  // A numeric literal that does not fit in its type. `str_val` is its text.
+  OVERFLOW_LEXEME,
+  // Declares an input of a program, as in `input int x`.
+  K_INPUT
 };
 
 typedef struct token {
-  int line;
-  int column;
+  // Byte offset of the token in the input. See `lexer_position()`.
+  long offset;
+  // Length of the token in the input.
+  int length;
   int type; // the value usually is enum token_type.
   union {
     char *str_val;
     int int_val;
+    double double_val;
     char ops_val;
     char err_val;
   };
 } token;
 
+// A scanner holds all the state of lexing one input. Scanners are
+// independent, so several inputs can be lexed at once on different threads,
+// but each scanner must only be used by one thread at a time.
+typedef struct lexer_scanner lexer_scanner;
+
+// Returns a scanner reading `file`, which is not closed by the scanner.
+lexer_scanner *lexer_open(FILE *file);
+
+// Returns a scanner for the file at `path`, or NULL if the file cannot be
+// opened. A regular file is mapped into memory and scanned in place, so the
+// text of tokens points into the mapping. Other files, such as pipes or
+// /dev/stdin, are read as streams, as by `lexer_open()`, and closed with the
+// scanner.
+lexer_scanner *lexer_open_file(const char *path);
+
+// Returns a scanner for the `size` bytes at `data`. The bytes are copied, so
+// they need not outlive the scanner, and need no terminator.
+lexer_scanner *lexer_open_buffer(const char *data, size_t size);
+
+token lexer_next(lexer_scanner *scanner);
+
+// Computes the line and column of a byte offset in the input read so far.
+// Lines and columns start from 1, and a newline token is at column 0 of the
+// line after it. This is a binary search, meant for reporting errors.
+void lexer_position(lexer_scanner *scanner, long offset, int *line,
+    int *column);
+
+// Frees the scanner. The text of its tokens is no longer valid.
+void lexer_close(lexer_scanner *scanner);
+
+// Returns the next token of a process wide scanner reading stdin, or the file
+// given to `yyrestart()`. Kept for lexer_test.c, which is shared with the
+// earlier versions of the lexer.
 token lexer();
+
+// A mapped file can be lexed in parallel. Its input is split into ranges that
+// end right after a newline, as no token spans a newline. Each range is lexed
+// by a scanner of its own, on any thread.
+typedef struct lexer_range lexer_range;
+
+// Returns the input mapped by `lexer_open_file()` and sets `size`, or returns
+// NULL if there is none, or if this lexer cannot lex ranges.
+const char *lexer_mapped_input(lexer_scanner *scanner, long *size);
+
+// Starts lexing [begin, end) of the mapped input. Token offsets are offsets in
+// the whole input. The text of tokens is not terminated, see `length`.
+lexer_range *lexer_range_open(lexer_scanner *scanner, long begin, long end);
+
+token lexer_range_next(lexer_range *range);
+
+// Frees the range, and adds its newlines to those known by `lexer_position()`
+// for its scanner. Ranges must be closed in the order of the input.
+void lexer_range_close(lexer_range *range);
 #endif
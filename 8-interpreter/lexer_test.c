@@ -29,6 +29,8 @@
 char *TEST_1="1/3*17-(2^3)+5;";
 char *TEST_2="(1/3*17)\n"; // ends with new line.
 char *TEST_3="12345/23-453281\n";
+char *TEST_4="1.5+.25*3e2-2.E-1/007.5 1e\n";
+char *TEST_5="2147483647+2147483648*1e309\n";
 
 typedef struct error_str {
   int len;
@@ -66,6 +68,36 @@ error_str is_int(int i, token t) {
   RETURN_SUCCESS;
 }
 
+error_str is_double(double d, token t) {
+  if (t.type != DOUBLE_LITERAL) {
+    RETURN_STR("Expecting double %g but got type %d.", d, t.type);
+  }
+  if (t.double_val != d) {
+    RETURN_STR("Expecting double %g but got %g.", d, t.double_val);
+  }
+  RETURN_SUCCESS;
+}
+
+error_str is_overflow(char *text, token t) {
+  if (t.type != OVERFLOW_LEXEME) {
+    RETURN_STR("Expecting overflow %s but got type %d.", text, t.type);
+  }
+  if (strcmp(t.str_val, text) != 0) {
+    RETURN_STR("Expecting overflow %s but got %s.", text, t.str_val);
+  }
+  RETURN_SUCCESS;
+}
+
+error_str is_identifier(char *name, token t) {
+  if (t.type != IDENTIFIER) {
+    RETURN_STR("Expecting identifier %s but got type %d.", name, t.type);
+  }
+  if (strcmp(t.str_val, name) != 0) {
+    RETURN_STR("Expecting identifier %s but got %s.", name, t.str_val);
+  }
+  RETURN_SUCCESS;
+}
+
 error_str test_1() {
   setup_test(TEST_1);
   ASSERT_NEXT_TOKEN(is_int, 1);
@@ -112,9 +144,41 @@ error_str test_large_number() {
   RETURN_SUCCESS;
 }
 
+error_str test_double() {
+  setup_test(TEST_4);
+  ASSERT_NEXT_TOKEN(is_double, 1.5);
+  ASSERT_NEXT_TOKEN(is_char, '+');
+  ASSERT_NEXT_TOKEN(is_double, 0.25);
+  ASSERT_NEXT_TOKEN(is_char, '*');
+  ASSERT_NEXT_TOKEN(is_double, 300);
+  ASSERT_NEXT_TOKEN(is_char, '-');
+  ASSERT_NEXT_TOKEN(is_double, 0.2);
+  ASSERT_NEXT_TOKEN(is_char, '/');
+  ASSERT_NEXT_TOKEN(is_double, 7.5);
+  ASSERT_NEXT_TOKEN(is_int, 1);
+  ASSERT_NEXT_TOKEN(is_identifier, "e");
+  ASSERT_NEXT_TOKEN(is_char, ';');
+  ASSERT_NEXT_TOKEN(is_null, 0);
+  RETURN_SUCCESS;
+}
+
+error_str test_overflow() {
+  setup_test(TEST_5);
+  ASSERT_NEXT_TOKEN(is_int, 2147483647);
+  ASSERT_NEXT_TOKEN(is_char, '+');
+  ASSERT_NEXT_TOKEN(is_overflow, "2147483648");
+  ASSERT_NEXT_TOKEN(is_char, '*');
+  ASSERT_NEXT_TOKEN(is_overflow, "1e309");
+  ASSERT_NEXT_TOKEN(is_char, ';');
+  ASSERT_NEXT_TOKEN(is_null, 0);
+  RETURN_SUCCESS;
+}
+
 int main() {
   RUN_TEST(test_1);
   RUN_TEST(test_newline);
   RUN_TEST(test_large_number);
+  RUN_TEST(test_double);
+  RUN_TEST(test_overflow);
   return 0;
 }
@@ -0,0 +1,53 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+#include <stdlib.h>
+
+/**
+ * Byte offsets of the newlines in the input, in increasing order. Tokens only
+ * carry their byte offset, and the lexer appends to the index whenever it
+ * returns a newline, so nothing is counted per character. The line and column
+ * of an offset are found by binary search when an error is reported.
+ *
+ * Shared by lexer.lex and simd_lexer.c, which are compiled as C or C++.
+ */
+typedef struct line_index {
+  long *newlines;
+  size_t size;
+  size_t capacity;
+} line_index;
+
+static void line_index_reset(line_index *index) {
+  index->size = 0;
+}
+
+static void line_index_add(line_index *index, long offset) {
+  if (index->size == index->capacity) {
+    index->capacity = index->capacity ? index->capacity * 2 : 1024;
+    index->newlines = (long *) realloc(
+        index->newlines, index->capacity * sizeof(long));
+  }
+  index->newlines[index->size++] = offset;
+}
+
+/**
+ * Lines and columns start from 1. As with flex --yylineno, a newline belongs
+ * to the line after it, with column 0.
+ */
+static void line_index_find(const line_index *index, long offset,
+    int *line, int *column) {
+  // Counts the newlines at or before `offset`.
+  size_t lo = 0;
+  size_t hi = index->size;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (index->newlines[mid] <= offset) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *line = (int) lo + 1;
+  *column = (int) (offset - (lo > 0 ? index->newlines[lo - 1] : -1));
+}
+
+#endif
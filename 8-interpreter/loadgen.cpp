@@ -0,0 +1,213 @@
+/**
+ * Measures `interpreter --serve`. Sends the program in `file` over and over
+ * on a few connections at once, and prints the requests per second and the
+ * percentiles of the latency of a request, from sending the program to
+ * receiving the status.
+ *
+ * Usage: loadgen [--connections=N] [--requests=N] [--path] socket file
+ *
+ * With --path, the path of the file is sent instead of its text, for the
+ * server to read.
+ */
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "server.h"
+
+using std::string;
+using std::vector;
+typedef std::chrono::steady_clock Clock;
+
+static bool send_all(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+static bool receive(int fd, char *data, size_t size) {
+  while (size > 0) {
+    ssize_t n = recv(fd, data, size, 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+static int connect_to(const char *path) {
+  struct sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd >= 0
+      && connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+    close(fd);
+    fd = -1;
+  }
+  return fd;
+}
+
+// Sends `request` and reads the response, throwing away the output. Returns
+// the status, or -1 if the connection failed.
+static int round_trip(int fd, const string &request, vector<char> &buffer) {
+  if (!send_all(fd, request.data(), request.size())) {
+    return -1;
+  }
+  for (;;) {
+    char header[kFrameHeaderLength];
+    if (!receive(fd, header, sizeof(header))) {
+      return -1;
+    }
+    uint32_t length = 0;
+    for (int i = 0; i < 4; i++) {
+      length |= (uint32_t) (unsigned char) header[1 + i] << (8 * i);
+    }
+    if (buffer.size() < length) {
+      buffer.resize(length);
+    }
+    if (!receive(fd, buffer.data(), length)) {
+      return -1;
+    }
+    if (header[0] == kFrameStatus) {
+      return length > 0 ? buffer[0] : -1;
+    }
+  }
+}
+
+static bool read_file(const char *path, string &text) {
+  FILE *file = fopen(path, "r");
+  if (file == nullptr) {
+    return false;
+  }
+  char block[64 * 1024];
+  size_t n;
+  while ((n = fread(block, 1, sizeof(block), file)) > 0) {
+    text.append(block, n);
+  }
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int connections = 4;
+  long requests = 100000;
+  bool send_path = false;
+  vector<const char *> args;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--connections=", 14) == 0) {
+      connections = atoi(argv[i] + 14);
+    } else if (strncmp(argv[i], "--requests=", 11) == 0) {
+      requests = atol(argv[i] + 11);
+    } else if (strcmp(argv[i], "--path") == 0) {
+      send_path = true;
+    } else if (argv[i][0] != '-') {
+      args.push_back(argv[i]);
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (args.size() != 2 || connections < 1 || requests < 1) {
+    fprintf(stderr, "Usage: loadgen [--connections=N] [--requests=N] [--path]"
+        " socket file\n");
+    return 1;
+  }
+
+  string payload;
+  if (send_path) {
+    payload = args[1];
+  } else if (!read_file(args[1], payload)) {
+    fprintf(stderr, "Cannot read %s: %s\n", args[1], strerror(errno));
+    return 1;
+  }
+  string request(kFrameHeaderLength, '\0');
+  request[0] = send_path ? kFramePath : kFrameProgram;
+  for (int i = 0; i < 4; i++) {
+    request[1 + i] = (char) (payload.size() >> (8 * i));
+  }
+  request += payload;
+
+  // Latencies in nanoseconds of the requests that got an answer, for each
+  // connection.
+  vector<vector<long>> latencies(connections);
+  std::atomic<long> failures(0);
+  std::atomic<long> errors(0);
+  vector<std::thread> clients;
+  Clock::time_point start = Clock::now();
+  for (int c = 0; c < connections; c++) {
+    long begin = requests * c / connections;
+    long end = requests * (c + 1) / connections;
+    clients.emplace_back([&, c, begin, end]() {
+      int fd = connect_to(args[0]);
+      if (fd < 0) {
+        failures += end - begin;
+        return;
+      }
+      vector<char> buffer;
+      for (long i = begin; i < end; i++) {
+        Clock::time_point sent = Clock::now();
+        int status = round_trip(fd, request, buffer);
+        if (status < 0) {
+          failures += end - i;
+          break;
+        }
+        latencies[c].push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+              Clock::now() - sent).count());
+        if (status != kRunOk) {
+          errors++;
+        }
+      }
+      close(fd);
+    });
+  }
+  for (std::thread &client : clients) {
+    client.join();
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  if (failures == requests) {
+    fprintf(stderr, "Cannot connect to %s\n", args[0]);
+    return 1;
+  }
+
+  vector<long> all;
+  for (const vector<long> &connection : latencies) {
+    all.insert(all.end(), connection.begin(), connection.end());
+  }
+  std::sort(all.begin(), all.end());
+  long answered = all.size();
+  printf("%ld requests in %.3f s, %.0f requests/s\n", answered, seconds,
+      answered / seconds);
+  printf("%ld failed, %ld reported an error\n", failures.load(),
+      errors.load());
+  const double percentiles[] = {50, 90, 99, 99.9, 100};
+  for (double p : percentiles) {
+    long i = std::min(answered - 1, (long) (answered * p / 100));
+    printf("p%-5g %10.1f us\n", p, all[i] / 1000.0);
+  }
+  return 0;
+}
@@ -0,0 +1,225 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "lexer.h"
+#include "output.h"
+#include "token_buffer.h"
+#include "batch.h"
+#include "bindings.h"
+#include "interpreter.h"
+#include "program_cache.h"
+#include "scheduler.h"
+#include "server.h"
+
+using std::unique_ptr;
+
+/**
+ * Usage: interpreter [--lines | --stream | --pipeline] [--jobs=N
+ *                    [--parallel-statements]] [--lex-all] [file]
+ *        interpreter --batch [--jobs=N [--cache] | --slice=N
+ *                    [--max-running=N]] [--output-dir=DIR] dir-or-list
+ *        interpreter --serve=SOCKET [--jobs=N]
+ *        interpreter --bindings=FILE [--jobs=N] file
+ *
+ * The program is read from `file` if given, otherwise from stdin. A file is
+ * mapped into memory and lexed in place, which avoids the read syscalls and
+ * the copying of stdin.
+ *
+ * --lines   Expression-per-line mode, see `run_lines()`.
+ * --throw-runtime-errors
+ *           With --lines on one thread, throws runtime errors as exceptions,
+ *           as they used to be, instead of returning them as a status, see
+ *           `EvalStatus`. The output is the same, only slower. For comparing,
+ *           see `make bench_errors`.
+ * --jobs=N  Runs on N worker threads. The lines of --lines mode are run in
+ *           batches, see `run_lines_parallel()`. The output is the same as
+ *           with one thread. Ignored with --stream and --pipeline.
+ * --parallel-statements
+ *           With --jobs=N, runs the statements of a program as soon as the
+ *           statements they depend on have run, see `Program::run_parallel()`.
+ *           Off by default, as statements are so short that the threads can
+ *           cost more than they gain, see `make bench_parallel`.
+ * --stream  Runs each statement as soon as it is parsed, and frees it right
+ *           after. Memory use does not grow with the length of the program,
+ *           and output starts before the whole program is read. The output
+ *           and error messages are the same as the default mode, except that
+ *           statements before a compiling error have already been run.
+ * --pipeline
+ *           Like --stream, but lexes, parses and runs on three threads, see
+ *           `run_pipelined()`.
+ * --batch   Runs every program of a directory, or listed in a file, on N
+ *           threads, see `run_batch()`. Each program is compiled and run in
+ *           the default mode.
+ * --cache   With --batch, compiles programs with the same source once, see
+ *           `ProgramCache`.
+ * --slice=N With --batch, runs the programs on one thread instead, each for N
+ *           statements in turn, see `run_batch_interleaved()`.
+ * --max-running=N
+ *           With --slice, starts at most N programs at a time, 512 by
+ *           default.
+ * --output-dir=DIR
+ *           With --batch, writes the output of each program to its own file
+ *           in DIR, instead of all of them tagged with their program.
+ * --serve=SOCKET
+ *           Stays resident and runs the programs sent to the Unix domain
+ *           socket SOCKET, on N threads, see `serve()`. `loadgen` measures
+ *           it.
+ * --bindings=FILE
+ *           Compiles the program in `file` once, and runs it once per line
+ *           of FILE, with the values on the line given to the inputs the
+ *           program declares with `input int x` or `input double x`, on N
+ *           threads, see `run_bindings()`.
+ * --lex-all Lexes the whole program before parsing it, instead of lexing it
+ *           in chunks while parsing.
+ * --lex-threads=N
+ *           Lexes a program file on N threads, a few megabytes of lines per
+ *           thread at a time, while the program is parsed. Only the simd
+ *           lexer supports this. Otherwise, or when reading stdin, the option
+ *           is ignored.
+ *
+ * Output, including error messages, goes to stdout unless one of these is
+ * given:
+ *
+ * --output=PATH  Writes the output to the file at PATH.
+ * --discard      Throws the output away.
+ * --checksum     Writes only a checksum and the length of the output, the
+ *                same as `checksum < expected-output.txt` would.
+ *
+ * --binary  Writes printed values and errors as binary records instead of
+ *           text, see `Output`. `render` turns them back into the text.
+ */
+int main(int argc, char **argv) {
+  bool lines = false;
+  bool streaming = false;
+  bool pipelined = false;
+  bool binary = false;
+  bool batch = false;
+  const char *output_dir = nullptr;
+  size_t slice = 0;
+  size_t max_running = kDefaultMaxRunning;
+  bool cache = false;
+  const char *socket_path = nullptr;
+  const char *bindings_path = nullptr;
+  size_t chunk_size = TokenBuffer::kDefaultChunkSize;
+  int lex_threads = 1;
+  int jobs = 1;
+  bool parallel_statements = false;
+  const char *path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--lines") == 0) {
+      lines = true;
+    } else if (strcmp(argv[i], "--throw-runtime-errors") == 0) {
+      eval_status.throwing = true;
+    } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+      jobs = atoi(argv[i] + 7);
+    } else if (strcmp(argv[i], "--parallel-statements") == 0) {
+      parallel_statements = true;
+    } else if (strcmp(argv[i], "--stream") == 0) {
+      streaming = true;
+    } else if (strcmp(argv[i], "--pipeline") == 0) {
+      pipelined = true;
+    } else if (strcmp(argv[i], "--batch") == 0) {
+      batch = true;
+    } else if (strncmp(argv[i], "--serve=", 8) == 0) {
+      socket_path = argv[i] + 8;
+    } else if (strncmp(argv[i], "--bindings=", 11) == 0) {
+      bindings_path = argv[i] + 11;
+    } else if (strcmp(argv[i], "--cache") == 0) {
+      cache = true;
+    } else if (strncmp(argv[i], "--slice=", 8) == 0) {
+      slice = strtoul(argv[i] + 8, nullptr, 10);
+    } else if (strncmp(argv[i], "--max-running=", 14) == 0) {
+      max_running = strtoul(argv[i] + 14, nullptr, 10);
+    } else if (strncmp(argv[i], "--output-dir=", 13) == 0) {
+      output_dir = argv[i] + 13;
+    } else if (strcmp(argv[i], "--lex-all") == 0) {
+      chunk_size = 0;
+    } else if (strncmp(argv[i], "--lex-threads=", 14) == 0) {
+      lex_threads = atoi(argv[i] + 14);
+    } else if (strcmp(argv[i], "--binary") == 0) {
+      binary = true;
+    } else if (strcmp(argv[i], "--discard") == 0) {
+      output.set_sink(unique_ptr<Sink>(new DiscardSink()));
+    } else if (strcmp(argv[i], "--checksum") == 0) {
+      output.set_sink(unique_ptr<Sink>(new ChecksumSink(stdout)));
+    } else if (strncmp(argv[i], "--output=", 9) == 0) {
+      FILE *file = fopen(argv[i] + 9, "w");
+      if (file == nullptr) {
+        fprintf(stderr, "Cannot write %s: %s\n", argv[i] + 9, strerror(errno));
+        return -1;
+      }
+      output.set_sink(unique_ptr<Sink>(new FileSink(file, true)));
+    } else if (argv[i][0] != '-' && path == nullptr) {
+      path = argv[i];
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return -1;
+    }
+  }
+  if (socket_path != nullptr) {
+    if (binary) {
+      output.set_format(Output::Format::Binary);
+    }
+    return serve(socket_path, jobs);
+  }
+  if (bindings_path != nullptr) {
+    if (path == nullptr) {
+      fprintf(stderr, "--bindings needs a program file\n");
+      return -1;
+    }
+    if (binary) {
+      output.set_format(Output::Format::Binary);
+    }
+    int status = run_bindings(path, bindings_path, jobs);
+    output.finish();
+    return status;
+  }
+  if (batch) {
+    if (path == nullptr) {
+      fprintf(stderr, "--batch needs a directory or a list of programs\n");
+      return -1;
+    }
+    if (binary) {
+      output.set_format(Output::Format::Binary);
+    }
+    int status;
+    if (slice > 0) {
+      status = run_batch_interleaved(path, slice, output_dir, max_running);
+    } else if (cache) {
+      ProgramCache programs;
+      status = run_batch(path, jobs, output_dir, &programs);
+    } else {
+      status = run_batch(path, jobs, output_dir);
+    }
+    output.finish();
+    return status;
+  }
+  lexer_scanner *scanner = path ? lexer_open_file(path) : lexer_open(stdin);
+  if (scanner == nullptr) {
+    fprintf(stderr, "Cannot read %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  if (binary) {
+    // Only once the sink is chosen, as the magic number is written right away.
+    output.set_format(Output::Format::Binary);
+  }
+  int status;
+  {
+    TokenBuffer tokens(scanner, chunk_size, lex_threads);
+    if (lines && jobs > 1) {
+      status = run_lines_parallel(tokens, jobs);
+    } else if (lines) {
+      status = run_lines(tokens);
+    } else if (pipelined) {
+      status = run_pipelined(tokens);
+    } else {
+      status = run_program(tokens, streaming,
+          parallel_statements && !streaming ? jobs : 1);
+    }
+  }
+  lexer_close(scanner);
+  output.finish();
+  return status;
+}
@@ -0,0 +1,137 @@
+#ifndef NUMBER_H
+#define NUMBER_H
+#include <locale.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+/**
+ * Conversion of numeric literals, shared by lexer.lex and simd_lexer.c. The
+ * lexers have already matched the text, so these only convert it. Unlike
+ * `atoi()` and `strtod()`, they never depend on the current locale, and they
+ * report literals that are out of range instead of wrapping around.
+ *
+ * Both return 0 on success, or -1 if the value is too large.
+ */
+
+// Decimal digits only, as matched by `0|[1-9][0-9]*`.
+static int parse_int_literal(const char *p, const char *end, int *value) {
+  int v = 0;
+  for (; p < end; p++) {
+    int d = *p - '0';
+    if (v > (INT_MAX - d) / 10) {
+      return -1;
+    }
+    v = v * 10 + d;
+  }
+  *value = v;
+  return 0;
+}
+
+// Created once, as the lexers may convert literals on several threads.
+static locale_t c_locale;
+static pthread_once_t c_locale_once = PTHREAD_ONCE_INIT;
+
+static void init_c_locale(void) {
+  c_locale = newlocale(LC_ALL_MASK, "C", (locale_t) 0);
+}
+
+/**
+ * Correctly rounded slow path. `strtod_l()` is not standard, so the thread
+ * switches to the C locale around `strtod()` instead.
+ */
+static int parse_double_slow(const char *p, const char *end, double *value) {
+  char small[64];
+  char *text = small;
+  size_t len = end - p;
+  locale_t old;
+  pthread_once(&c_locale_once, init_c_locale);
+  // The literal is not terminated in the lexer's buffer.
+  if (len >= sizeof(small)) {
+    text = (char *) malloc(len + 1);
+  }
+  memcpy(text, p, len);
+  text[len] = '\0';
+  old = uselocale(c_locale);
+  *value = strtod(text, NULL);
+  uselocale(old);
+  if (text != small) {
+    free(text);
+  }
+  return *value == HUGE_VAL ? -1 : 0;
+}
+
+/**
+ * Matched by `([0-9]+\.[0-9]*|\.[0-9]+)([eE][+-]?[0-9]+)?` or
+ * `[0-9]+[eE][+-]?[0-9]+`.
+ *
+ * Most literals have at most 19 significant digits and a small exponent. If
+ * the digits fit in the 53 bits of a double and the power of ten is at most
+ * 10^22, both are exact doubles, and a single multiplication or division is
+ * correctly rounded (Clinger's fast path). Everything else is left to the
+ * slow path.
+ */
+static int parse_double_literal(const char *p, const char *end,
+    double *value) {
+  static const double powers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+  const char *start = p;
+  uint64_t mantissa = 0;
+  // Significant digits, which stop being added to `mantissa` after 19.
+  int digits = 0;
+  long exponent = 0;
+
+  for (; p < end && *p >= '0' && *p <= '9'; p++) {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+    }
+    digits += mantissa != 0;
+  }
+  if (p < end && *p == '.') {
+    for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+      }
+      digits += mantissa != 0;
+      exponent--;
+    }
+  }
+  if (p < end) {
+    // [eE][+-]?[0-9]+
+    int negative = 0;
+    long e = 0;
+    p++;
+    if (*p == '+' || *p == '-') {
+      negative = *p++ == '-';
+    }
+    for (; p < end; p++) {
+      // Large enough to overflow or underflow any double.
+      if (e < 100000) {
+        e = e * 10 + (*p - '0');
+      }
+    }
+    exponent += negative ? -e : e;
+  }
+
+  if (mantissa == 0) {
+    *value = 0.0;
+    return 0;
+  }
+  if (digits > 19 || mantissa > ((uint64_t) 1 << 53)
+      || exponent < -22 || exponent > 22) {
+    return parse_double_slow(start, end, value);
+  }
+  if (exponent < 0) {
+    *value = (double) mantissa / powers[-exponent];
+  } else {
+    *value = (double) mantissa * powers[exponent];
+  }
+  return 0;
+}
+
+#endif
@@ -0,0 +1,247 @@
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+#include "output.h"
+
+Output output(std::unique_ptr<Sink>(new FileSink(stdout)));
+
+static const char kDigitPairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+// Writes the decimal digits of `value`, two at a time from the end.
+static size_t format_uint64(char *buffer, uint64_t value) {
+  char digits[20];
+  char *p = digits + sizeof(digits);
+  while (value >= 100) {
+    p -= 2;
+    memcpy(p, kDigitPairs + value % 100 * 2, 2);
+    value /= 100;
+  }
+  if (value >= 10) {
+    p -= 2;
+    memcpy(p, kDigitPairs + value * 2, 2);
+  } else {
+    *--p = '0' + value;
+  }
+  size_t length = digits + sizeof(digits) - p;
+  memcpy(buffer, p, length);
+  return length;
+}
+
+size_t format_int(char *buffer, int value) {
+  if (value < 0) {
+    *buffer = '-';
+    return 1 + format_uint64(buffer + 1, 0u - (unsigned) value);
+  }
+  return format_uint64(buffer, value);
+}
+
+size_t format_fixed2(char *buffer, double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  bool negative = bits >> 63;
+  int exponent = (bits >> 52) & 0x7ff;
+  uint64_t mantissa = bits & ((UINT64_C(1) << 52) - 1);
+  char *p = buffer;
+
+  if (exponent == 0x7ff) {
+    if (negative) {
+      *p++ = '-';
+    }
+    memcpy(p, mantissa ? "nan" : "inf", 3);
+    return p + 3 - buffer;
+  }
+  if (exponent >= 1023 + 63) {
+    // At least 2^63. Printing every digit of such a value needs big integer
+    // arithmetic, so these rare values are left to printf.
+    char text[kMaxFixed2Length + 1];
+    size_t length = snprintf(text, sizeof(text), "%.2f", value);
+    memcpy(buffer, text, length);
+    return length;
+  }
+
+  // value = mantissa * 2^exponent exactly.
+  if (exponent == 0) {
+    exponent = -1074;
+  } else {
+    mantissa |= UINT64_C(1) << 52;
+    exponent -= 1075;
+  }
+  uint64_t integer;
+  uint64_t cents;
+  if (exponent >= 0) {
+    integer = mantissa << exponent;
+    cents = 0;
+  } else {
+    // Rounds mantissa * 100 / 2^-exponent, which is exact in 64 bits as the
+    // mantissa has 53 bits.
+    int shift = -exponent;
+    uint64_t scaled = mantissa * 100;
+    uint64_t rounded = 0;
+    if (shift < 64) {
+      uint64_t half = UINT64_C(1) << (shift - 1);
+      uint64_t rest = scaled & ((half << 1) - 1);
+      rounded = scaled >> shift;
+      if (rest > half || (rest == half && (rounded & 1))) {
+        rounded++;
+      }
+    }
+    integer = rounded / 100;
+    cents = rounded % 100;
+  }
+
+  // Like printf, negative values that round to zero keep their sign.
+  if (negative) {
+    *p++ = '-';
+  }
+  p += format_uint64(p, integer);
+  *p++ = '.';
+  memcpy(p, kDigitPairs + cents * 2, 2);
+  return p + 2 - buffer;
+}
+
+void FileSink::write(const char *data, size_t size) {
+  fwrite(data, 1, size, file);
+}
+
+void FileSink::finish() {
+  if (owned) {
+    fclose(file);
+  } else {
+    fflush(file);
+  }
+}
+
+bool FileSink::interactive() const {
+  return isatty(fileno(file));
+}
+
+void ChecksumSink::write(const char *data, size_t size) {
+  uint64_t h = hash;
+  for (size_t i = 0; i < size; i++) {
+    h = (h ^ (unsigned char) data[i]) * kPrime;
+  }
+  hash = h;
+  length += size;
+}
+
+void ChecksumSink::finish() {
+  fprintf(report, "%016llx %llu\n",
+      (unsigned long long) hash, (unsigned long long) length);
+  fflush(report);
+}
+
+Output::Output(std::unique_ptr<Sink> sink)
+  : sink(std::move(sink)), format(Format::Text), size(0) {
+  line_buffered = this->sink->interactive();
+}
+
+Output::Output(std::unique_ptr<Sink> sink, Format format)
+  : sink(std::move(sink)), format(format), size(0) {
+  line_buffered = this->sink->interactive();
+}
+
+void Output::set_sink(std::unique_ptr<Sink> sink) {
+  finish();
+  this->sink = std::move(sink);
+  line_buffered = this->sink->interactive();
+}
+
+void Output::set_format(Format format) {
+  if (format == Format::Binary && this->format != Format::Binary) {
+    write(kBinaryMagic);
+  }
+  this->format = format;
+}
+
+void Output::print_error(const char *kind, const char *message) {
+  if (format == Format::Text) {
+    write(kind);
+    write(message);
+    end_line();
+    return;
+  }
+  write_text_record(kRecordError, kind, message);
+}
+
+void Output::print_program(const char *path) {
+  if (format == Format::Text) {
+    write("==> ");
+    write(path);
+    write(" <==");
+    end_line();
+    return;
+  }
+  write_text_record(kRecordProgram, "", path);
+}
+
+void Output::write_text_record(RecordKind kind, const char *prefix,
+    const char *text) {
+  size_t prefix_length = strlen(prefix);
+  size_t text_length = strlen(text);
+  size_t length = prefix_length + text_length;
+  // Messages are short, but the length of a record has 16 bits.
+  if (length > 0xffff - kRecordHeaderLength) {
+    length = 0xffff - kRecordHeaderLength;
+  }
+  if (size + kRecordHeaderLength + length > kBufferSize) {
+    flush();
+  }
+  put_le(kRecordHeaderLength - 2 + length, 2);
+  buffer[size++] = (char) kind;
+  put_le(kNoStatement, 4);
+  char *payload = buffer + size;
+  if (prefix_length > length) {
+    prefix_length = length;
+  }
+  memcpy(payload, prefix, prefix_length);
+  memcpy(payload + prefix_length, text, length - prefix_length);
+  size += length;
+}
+
+void Output::write(const char *text) {
+  put(text, strlen(text));
+}
+
+void Output::append(const char *data, size_t size) {
+  put(data, size);
+  if (line_buffered) {
+    flush();
+  }
+}
+
+void Output::put(const char *data, size_t length) {
+  if (size + length > kBufferSize) {
+    flush();
+    if (length > kBufferSize) {
+      sink->write(data, length);
+      return;
+    }
+  }
+  memcpy(buffer + size, data, length);
+  size += length;
+}
+
+void Output::flush() {
+  if (size > 0) {
+    sink->write(buffer, size);
+    size = 0;
+  }
+}
+
+void Output::finish() {
+  if (sink) {
+    flush();
+    sink->finish();
+    sink.reset();
+  }
+}
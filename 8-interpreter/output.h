@@ -0,0 +1,263 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+// Longest text of `format_int()`, e.g. "-2147483648".
+const size_t kMaxIntLength = 11;
+// Longest text of `format_fixed2()`, i.e. "-DBL_MAX.00", which has 309 digits
+// before the point.
+const size_t kMaxFixed2Length = 313;
+
+// Writes `value` like `printf("%d")` without the terminating NUL. Returns the
+// number of characters written.
+size_t format_int(char *buffer, int value);
+
+// Writes `value` like `printf("%.2lf")` in the C locale, without the
+// terminating NUL, and returns the number of characters written. The decimal
+// value of the double is rounded exactly, with ties to even, as glibc does.
+size_t format_fixed2(char *buffer, double value);
+
+/**
+ * Where the output ends up. A sink receives the output in large blocks.
+ */
+class Sink {
+  public:
+  virtual ~Sink() {}
+
+  virtual void write(const char *data, size_t size) = 0;
+
+  // Called once after the last write.
+  virtual void finish() {}
+
+  // Whether somebody is watching the output as it is written, so that it
+  // should be written line by line.
+  virtual bool interactive() const {
+    return false;
+  }
+};
+
+// Writes to a file, e.g. stdout.
+class FileSink: public Sink {
+  FILE *file;
+  // Files opened by the sink are also closed by it.
+  bool owned;
+
+  public:
+  FileSink(FILE *file, bool owned = false) : file(file), owned(owned) {}
+
+  void write(const char *data, size_t size) override;
+  void finish() override;
+  bool interactive() const override;
+};
+
+// Keeps the output in memory, for embedding the interpreter and for tests.
+class MemorySink: public Sink {
+  std::string text_;
+
+  public:
+  const std::string &text() const {
+    return text_;
+  }
+
+  void write(const char *data, size_t size) override {
+    text_.append(data, size);
+  }
+};
+
+// Throws the output away, to time the interpreter alone.
+class DiscardSink: public Sink {
+  public:
+  void write(const char *, size_t) override {}
+};
+
+/**
+ * Hashes the output with 64-bit FNV-1a instead of writing it, and writes only
+ * the hash and the length when finished, in the same format as the checksum
+ * tool. Benchmarks can then check their output against a reference file
+ * without timing the terminal or a pipe.
+ */
+class ChecksumSink: public Sink {
+  FILE *report;
+  uint64_t hash;
+  uint64_t length;
+
+  public:
+  static const uint64_t kOffsetBasis = UINT64_C(0xcbf29ce484222325);
+  static const uint64_t kPrime = UINT64_C(0x100000001b3);
+
+  ChecksumSink(FILE *report)
+    : report(report), hash(kOffsetBasis), length(0) {}
+
+  uint64_t checksum() const {
+    return hash;
+  }
+
+  void write(const char *data, size_t size) override;
+  void finish() override;
+};
+
+/**
+ * Binary output starts with the 4 bytes of `kBinaryMagic`, followed by one
+ * record per printed value or error:
+ *
+ *   length     uint16, bytes in the rest of the record
+ *   kind       uint8, a `RecordKind`
+ *   statement  uint32, index of the statement in the program
+ *   payload    int32 or float64 for values, the message for errors, the
+ *              path for programs
+ *
+ * Numbers are little-endian, and doubles are stored as their IEEE 754 bits.
+ * Readers skip records of kinds they do not know, using the length.
+ */
+const char kBinaryMagic[] = "IRB1";
+const size_t kRecordHeaderLength = 7;
+// Statement index of errors that do not belong to a statement.
+const uint32_t kNoStatement = 0xffffffff;
+
+enum RecordKind {
+  kRecordInt = 'i',
+  kRecordDouble = 'd',
+  kRecordError = 'e',
+  // Starts the output of a program, in the combined output of a batch.
+  kRecordProgram = 'p',
+};
+
+/**
+ * Program output goes through a large buffer that is passed to the sink in
+ * bulk, instead of through a `printf()` per print statement, which parses the
+ * format string and locks the stream every time.
+ *
+ * The sink is finished when the `Output` is destroyed, or when it is replaced.
+ * Interactive sinks get each line as soon as it is completed.
+ */
+class Output {
+  public:
+  static const size_t kBufferSize = 64 * 1024;
+
+  enum class Format {
+    Text,
+    Binary,
+  };
+
+  Output(std::unique_ptr<Sink> sink);
+
+  // Writes in `format` from the start, without the magic number of binary
+  // output. For parts of the output that are produced separately, e.g. on
+  // other threads, and then passed to `append()` of the real output.
+  Output(std::unique_ptr<Sink> sink, Format format);
+
+  ~Output() {
+    finish();
+  }
+
+  // Finishes the current sink and writes to `sink` from now on.
+  void set_sink(std::unique_ptr<Sink> sink);
+
+  // Switching to binary writes the magic number first.
+  void set_format(Format format);
+
+  Format current_format() const {
+    return format;
+  }
+
+  // The value printed by a statement.
+  void print_int(int value, uint32_t statement) {
+    if (format == Format::Text) {
+      write_int(value);
+      end_line();
+      return;
+    }
+    uint32_t bits = value;
+    write_record(kRecordInt, statement, bits, 4);
+  }
+
+  void print_double(double value, uint32_t statement) {
+    if (format == Format::Text) {
+      write_fixed2(value);
+      end_line();
+      return;
+    }
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    write_record(kRecordDouble, statement, bits, 8);
+  }
+
+  // An error message, e.g. `print_error("Runtime error: ", message)`.
+  void print_error(const char *kind, const char *message);
+
+  // Starts the output of the program at `path` when the output of several
+  // programs is combined. The text format shows it as `==> path <==`.
+  void print_program(const char *path);
+
+  void write_int(int value) {
+    reserve(kMaxIntLength);
+    size += format_int(buffer + size, value);
+  }
+
+  void write_fixed2(double value) {
+    reserve(kMaxFixed2Length);
+    size += format_fixed2(buffer + size, value);
+  }
+
+  void write(const char *text);
+
+  // Writes output produced by another `Output` in the same format.
+  void append(const char *data, size_t size);
+
+  void end_line() {
+    reserve(1);
+    buffer[size++] = '\n';
+    if (line_buffered) {
+      flush();
+    }
+  }
+
+  void flush();
+
+  // Flushes the buffer and finishes the sink. Nothing can be written after.
+  void finish();
+
+  private:
+  std::unique_ptr<Sink> sink;
+  Format format;
+  bool line_buffered;
+  size_t size;
+  char buffer[kBufferSize];
+
+  void put(const char *data, size_t length);
+
+  // A record whose payload is `prefix` followed by `text`.
+  void write_text_record(RecordKind kind, const char *prefix,
+      const char *text);
+
+  void reserve(size_t n) {
+    if (size + n > kBufferSize) {
+      flush();
+    }
+  }
+
+  void put_le(uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+      buffer[size++] = (char) (value >> (8 * i));
+    }
+  }
+
+  void write_record(RecordKind kind, uint32_t statement, uint64_t payload,
+      size_t payload_length) {
+    reserve(kRecordHeaderLength + payload_length);
+    put_le(kRecordHeaderLength - 2 + payload_length, 2);
+    buffer[size++] = (char) kind;
+    put_le(statement, 4);
+    put_le(payload, payload_length);
+  }
+};
+
+// Output of print statements.
+extern Output output;
+
+#endif
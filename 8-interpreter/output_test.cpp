@@ -0,0 +1,231 @@
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "output.h"
+#define RETURN_STR(...) { \
+  error_str r; \
+  r.len = asprintf(&(r.str), __VA_ARGS__); \
+  return r; \
+}
+#define RETURN_SUCCESS { return SUCCESS; }
+#define ASSERT_SAME_AS_PRINTF(func, value) { \
+  error_str r = func(value); \
+  if (r.len != 0) { \
+    char *msg = r.str; \
+    r.len = asprintf(&(r.str), "At %s line %d: %s", __FILE__, __LINE__, msg); \
+    return r; \
+  } \
+}
+#define RUN_TEST(func) { \
+  printf("Test %s running...\n", #func); \
+  error_str r = func(); \
+  if (r.len != 0) { \
+    printf("Test %s failed: %s\n", #func, r.str); \
+  } else { \
+    printf("Test %s passed.\n", #func); \
+  } \
+}
+
+typedef struct error_str {
+  int len;
+  char *str;
+} error_str;
+const error_str SUCCESS = {0, NULL};
+
+error_str is_same_int(int value) {
+  char expected[kMaxIntLength + 1];
+  char actual[kMaxIntLength + 1];
+  snprintf(expected, sizeof(expected), "%d", value);
+  actual[format_int(actual, value)] = '\0';
+  if (strcmp(expected, actual) != 0) {
+    RETURN_STR("Expecting %s but got %s.", expected, actual);
+  }
+  RETURN_SUCCESS;
+}
+
+error_str is_same_fixed2(double value) {
+  char expected[kMaxFixed2Length + 1];
+  char actual[kMaxFixed2Length + 1];
+  snprintf(expected, sizeof(expected), "%.2lf", value);
+  actual[format_fixed2(actual, value)] = '\0';
+  if (strcmp(expected, actual) != 0) {
+    RETURN_STR("Expecting %s but got %s for %a.", expected, actual, value);
+  }
+  RETURN_SUCCESS;
+}
+
+double from_bits(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+error_str test_int() {
+  ASSERT_SAME_AS_PRINTF(is_same_int, 0);
+  ASSERT_SAME_AS_PRINTF(is_same_int, 7);
+  ASSERT_SAME_AS_PRINTF(is_same_int, -7);
+  ASSERT_SAME_AS_PRINTF(is_same_int, 10);
+  ASSERT_SAME_AS_PRINTF(is_same_int, 99);
+  ASSERT_SAME_AS_PRINTF(is_same_int, 100);
+  ASSERT_SAME_AS_PRINTF(is_same_int, 1234567);
+  ASSERT_SAME_AS_PRINTF(is_same_int, INT_MAX);
+  ASSERT_SAME_AS_PRINTF(is_same_int, INT_MIN);
+  for (int i = 0; i < 1000000; i++) {
+    ASSERT_SAME_AS_PRINTF(is_same_int, (int) (rand() - RAND_MAX / 2));
+  }
+  RETURN_SUCCESS;
+}
+
+error_str test_fixed2_special() {
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, 0.0);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, -0.0);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, 1.0);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, -1.0);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, -0.001);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, DBL_MIN);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, from_bits(1));
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, DBL_MAX);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, -DBL_MAX);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, 9223372036854775807.0);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, 9223372036854774784.0);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, 1e300);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, INFINITY);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, -INFINITY);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, NAN);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, -NAN);
+  RETURN_SUCCESS;
+}
+
+error_str test_fixed2_ties() {
+  // Exact ties round to even, others by their exact binary value.
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, 0.125);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, 0.375);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, -0.125);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, 0.005);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, 1.005);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, 2.675);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, 0.995);
+  ASSERT_SAME_AS_PRINTF(is_same_fixed2, 99.995);
+  for (int i = -100000; i <= 100000; i++) {
+    ASSERT_SAME_AS_PRINTF(is_same_fixed2, i / 8.0);
+    ASSERT_SAME_AS_PRINTF(is_same_fixed2, i / 1000.0);
+  }
+  RETURN_SUCCESS;
+}
+
+error_str test_fixed2_random() {
+  for (int i = 0; i < 1000000; i++) {
+    // Random bits cover every magnitude, including subnormals and NaNs.
+    uint64_t bits = (uint64_t) rand() << 62 ^ (uint64_t) rand() << 31 ^ rand();
+    ASSERT_SAME_AS_PRINTF(is_same_fixed2, from_bits(bits));
+    // Values with a few decimals, as printed by most programs.
+    double value = (rand() - RAND_MAX / 2) / (double) (1 << (rand() % 20));
+    ASSERT_SAME_AS_PRINTF(is_same_fixed2, value);
+  }
+  RETURN_SUCCESS;
+}
+
+error_str test_memory_sink() {
+  MemorySink *memory = new MemorySink();
+  Output out{std::unique_ptr<Sink>(memory)};
+  std::string expected;
+  char text[kMaxFixed2Length + 1];
+  // Enough lines to fill the buffer a few times.
+  for (int i = 0; i < 100000; i++) {
+    out.write_int(i - 50000);
+    out.end_line();
+    out.write_fixed2(i / 3.0);
+    out.end_line();
+    snprintf(text, sizeof(text), "%d\n%.2lf\n", i - 50000, i / 3.0);
+    expected += text;
+  }
+  out.write("done");
+  expected += "done";
+  out.flush();
+  if (memory->text() != expected) {
+    RETURN_STR("Expecting %zu bytes but got %zu.",
+        expected.size(), memory->text().size());
+  }
+  RETURN_SUCCESS;
+}
+
+error_str test_binary_format() {
+  MemorySink *memory = new MemorySink();
+  Output out{std::unique_ptr<Sink>(memory)};
+  out.set_format(Output::Format::Binary);
+  out.print_int(-2, 1);
+  out.print_double(1.0, 258);
+  out.print_error("E: ", "x");
+  out.flush();
+  const char expected[] =
+    "IRB1"
+    "\x09\x00" "i" "\x01\x00\x00\x00" "\xfe\xff\xff\xff"
+    "\x0d\x00" "d" "\x02\x01\x00\x00"
+    "\x00\x00\x00\x00\x00\x00\xf0\x3f"
+    "\x09\x00" "e" "\xff\xff\xff\xff" "E: x";
+  if (memory->text() != std::string(expected, sizeof(expected) - 1)) {
+    RETURN_STR("Unexpected binary output of %zu bytes.",
+        memory->text().size());
+  }
+  RETURN_SUCCESS;
+}
+
+error_str test_program_records() {
+  MemorySink *memory = new MemorySink();
+  Output out{std::unique_ptr<Sink>(memory)};
+  out.print_program("a.txt");
+  out.append("1\n", 2);
+  out.flush();
+  if (memory->text() != "==> a.txt <==\n1\n") {
+    RETURN_STR("Unexpected text output %s.", memory->text().c_str());
+  }
+  memory = new MemorySink();
+  out.set_sink(std::unique_ptr<Sink>(memory));
+  out.set_format(Output::Format::Binary);
+  out.print_program("a.txt");
+  out.flush();
+  const char expected[] =
+    "IRB1" "\x0a\x00" "p" "\xff\xff\xff\xff" "a.txt";
+  if (memory->text() != std::string(expected, sizeof(expected) - 1)) {
+    RETURN_STR("Unexpected binary output of %zu bytes.",
+        memory->text().size());
+  }
+  RETURN_SUCCESS;
+}
+
+error_str test_checksum_sink() {
+  // The report written when the sink is finished is not checked.
+  FILE *report = tmpfile();
+  ChecksumSink *checksum = new ChecksumSink(report);
+  Output out{std::unique_ptr<Sink>(checksum)};
+  out.flush();
+  if (checksum->checksum() != UINT64_C(0xcbf29ce484222325)) {
+    RETURN_STR("Expecting the offset basis for no output.");
+  }
+  out.write("a");
+  out.flush();
+  if (checksum->checksum() != UINT64_C(0xaf63dc4c8601ec8c)) {
+    RETURN_STR("Expecting af63dc4c8601ec8c but got %016llx.",
+        (unsigned long long) checksum->checksum());
+  }
+  out.finish();
+  fclose(report);
+  RETURN_SUCCESS;
+}
+
+int main() {
+  RUN_TEST(test_int);
+  RUN_TEST(test_fixed2_special);
+  RUN_TEST(test_fixed2_ties);
+  RUN_TEST(test_fixed2_random);
+  RUN_TEST(test_memory_sink);
+  RUN_TEST(test_binary_format);
+  RUN_TEST(test_program_records);
+  RUN_TEST(test_checksum_sink);
+  return 0;
+}
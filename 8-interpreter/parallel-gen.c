@@ -0,0 +1,27 @@
+/**
+ * Generates a program for `interpreter --parallel-statements` of print
+ * statements, which do not depend on each other, the best case for running
+ * them in parallel. Only literals are used, so that the program compiles
+ * without the homework. Usage: parallel-gen [statements] [operators]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#define N 1000000
+#define OPERATORS 16
+#define N_OPS 3
+
+const char ops[] = "+-*";
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : N;
+  int operators = argc > 2 ? atoi(argv[2]) : OPERATORS;
+  // No srand, on purpose.
+  for (int i = 0; i < n; i++) {
+    printf("print %d.5", rand() % 100);
+    for (int j = 0; j < operators; j++) {
+      printf(" %c %d.5", ops[rand() % N_OPS], rand() % 10);
+    }
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "interpreter.h"
+#include "lexer.h"
+#include "output.h"
+#include "token_buffer.h"
+#define RETURN_STR(...) { \
+  error_str r; \
+  r.len = asprintf(&(r.str), __VA_ARGS__); \
+  return r; \
+}
+#define RETURN_SUCCESS { return SUCCESS; }
+#define ASSERT(condition, ...) { \
+  if (!(condition)) { \
+    RETURN_STR(__VA_ARGS__); \
+  } \
+}
+#define RUN_TEST(func) { \
+  printf("Test %s running...\n", #func); \
+  error_str r = func(); \
+  if (r.len != 0) { \
+    printf("Test %s failed: %s\n", #func, r.str); \
+  } else { \
+    printf("Test %s passed.\n", #func); \
+  } \
+}
+
+typedef struct error_str {
+  int len;
+  char *str;
+} error_str;
+const error_str SUCCESS = {0, NULL};
+
+// Far more chunks than `TokenBuffer` lexes ahead, so that the lexer thread is
+// still running when the error is reported.
+const size_t kChunkSize = 1024;
+const int kLines = 400000;
+
+// A program of `kLines` print statements, with a compiling error at `line`.
+std::string program_with_error(int line) {
+  std::string source;
+  for (int i = 1; i <= kLines; i++) {
+    source += i == line ? "print 1 2\n" : "print 1\n";
+  }
+  return source;
+}
+
+// Runs `source` with `--pipeline`, or streaming on one thread, and returns the
+// output.
+std::string run(const std::string &source, bool pipelined) {
+  MemorySink *sink = new MemorySink();
+  output.set_sink(std::unique_ptr<Sink>(sink));
+  lexer_scanner *scanner = lexer_open_buffer(source.data(), source.size());
+  {
+    TokenBuffer tokens(scanner, kChunkSize);
+    if (pipelined) {
+      run_pipelined(tokens);
+    } else {
+      run_program(tokens, true, 1);
+    }
+  }
+  lexer_close(scanner);
+  output.flush();
+  std::string text = sink->text();
+  output.set_sink(std::unique_ptr<Sink>(new MemorySink()));
+  return text;
+}
+
+error_str test_error_at_start() {
+  std::string source = program_with_error(1);
+  std::string expected = run(source, false);
+  ASSERT(expected.find("Compiling error: ") == 0
+      && expected.find("line 1,") != std::string::npos,
+      "Unexpected streaming output %s", expected.c_str());
+  std::string actual = run(source, true);
+  ASSERT(actual == expected, "Expecting %s but got %s", expected.c_str(),
+      actual.c_str());
+  RETURN_SUCCESS;
+}
+
+error_str test_error_in_the_middle() {
+  std::string source = program_with_error(kLines / 2);
+  std::string expected = run(source, false);
+  ASSERT(expected.find("line 200000,") != std::string::npos,
+      "Unexpected streaming output %s",
+      expected.substr(expected.size() - 100).c_str());
+  std::string actual = run(source, true);
+  ASSERT(actual == expected, "Expecting the output of streaming but got %s",
+      actual.substr(actual.size() - 100).c_str());
+  RETURN_SUCCESS;
+}
+
+int main() {
+  RUN_TEST(test_error_at_start);
+  RUN_TEST(test_error_in_the_middle);
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include "lexer.h"
+#include "program_cache.h"
+#include "token_buffer.h"
+
+using std::shared_ptr;
+using std::string;
+
+ProgramCache::ProgramCache(size_t capacity)
+  : capacity(capacity), size(0), compile_count(0) {
+  // At most one entry per two buckets, so that lists stay short.
+  size_t bucket_count = 1;
+  while (bucket_count < 2 * capacity) {
+    bucket_count *= 2;
+  }
+  mask = bucket_count - 1;
+  buckets.reset(new std::atomic<Entry *>[bucket_count]);
+  for (size_t i = 0; i < bucket_count; i++) {
+    buckets[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+ProgramCache::~ProgramCache() {
+  for (size_t i = 0; i <= mask; i++) {
+    Entry *entry = buckets[i].load(std::memory_order_relaxed);
+    while (entry != nullptr) {
+      Entry *next = entry->next;
+      delete entry;
+      entry = next;
+    }
+  }
+}
+
+uint64_t ProgramCache::hash(const string &source) {
+  // FNV-1a, as for `ChecksumSink`.
+  uint64_t h = UINT64_C(0xcbf29ce484222325);
+  for (unsigned char c : source) {
+    h = (h ^ c) * UINT64_C(0x100000001b3);
+  }
+  return h;
+}
+
+shared_ptr<const Program> ProgramCache::find(uint64_t hash,
+    const string &source) const {
+  const Entry *entry = buckets[hash & mask].load(std::memory_order_acquire);
+  for (; entry != nullptr; entry = entry->next) {
+    if (entry->hash == hash && entry->source == source) {
+      return entry->program;
+    }
+  }
+  return nullptr;
+}
+
+static std::unique_ptr<Program> compile(const string &source) {
+  lexer_scanner *scanner = lexer_open_buffer(source.data(), source.size());
+  std::unique_ptr<Program> p;
+  try {
+    TokenBuffer tokens(scanner);
+    p = parse_program(tokens);
+  } catch (...) {
+    lexer_close(scanner);
+    throw;
+  }
+  lexer_close(scanner);
+  return p;
+}
+
+shared_ptr<const Program> ProgramCache::get(const string &source) {
+  uint64_t h = hash(source);
+  shared_ptr<const Program> program = find(h, source);
+  if (program) {
+    return program;
+  }
+
+  std::unique_ptr<Program> compiled = compile(source);
+  compile_count.fetch_add(1, std::memory_order_relaxed);
+  compiled->number_variables();
+  program.reset(compiled.release());
+
+  std::lock_guard<std::mutex> lock(insert_mutex);
+  // Another thread may have compiled it meanwhile.
+  shared_ptr<const Program> existing = find(h, source);
+  if (existing) {
+    return existing;
+  }
+  if (size == capacity) {
+    return program;
+  }
+  std::atomic<Entry *> &bucket = buckets[h & mask];
+  Entry *entry = new Entry{h, source, program,
+    bucket.load(std::memory_order_relaxed)};
+  bucket.store(entry, std::memory_order_release);
+  size++;
+  return program;
+}
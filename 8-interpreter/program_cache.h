@@ -0,0 +1,65 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "interpreter.h"
+
+/**
+ * Compiled programs keyed by their source, shared by all threads. A program
+ * submitted again is not compiled again, and the threads running it share
+ * it, each with its own `Frame`, see `Program::run(Output &, Frame &)`.
+ *
+ * Looking up a program takes no lock. Each bucket is a list of entries that
+ * never change once added, and a new entry is only ever put in front, with a
+ * release store of the head, which lookups read with an acquire load. Only
+ * adding an entry takes a lock, after the program is compiled outside of it.
+ *
+ * Entries are never removed, so that lookups need not guard against them
+ * being freed. Once the cache holds `capacity` programs, others are compiled
+ * on every request, and not kept.
+ */
+class ProgramCache {
+  public:
+  static const size_t kDefaultCapacity = 1024;
+
+  explicit ProgramCache(size_t capacity = kDefaultCapacity);
+  ~ProgramCache();
+
+  ProgramCache(const ProgramCache &) = delete;
+  ProgramCache &operator=(const ProgramCache &) = delete;
+
+  // Returns the compiled program, compiling it if needed. Compiling errors
+  // are thrown, and not cached.
+  std::shared_ptr<const Program> get(const std::string &source);
+
+  // Programs compiled so far, including those not kept.
+  size_t compiled() const {
+    return compile_count.load(std::memory_order_relaxed);
+  }
+
+  private:
+  struct Entry {
+    uint64_t hash;
+    std::string source;
+    std::shared_ptr<const Program> program;
+    Entry *next;
+  };
+
+  const size_t capacity;
+  size_t mask;
+  std::unique_ptr<std::atomic<Entry *>[]> buckets;
+  // Only changed while holding `insert_mutex`.
+  size_t size;
+  std::mutex insert_mutex;
+  std::atomic<size_t> compile_count;
+
+  static uint64_t hash(const std::string &source);
+  std::shared_ptr<const Program> find(uint64_t hash,
+      const std::string &source) const;
+};
+
+#endif
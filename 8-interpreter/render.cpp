@@ -0,0 +1,89 @@
+/**
+ * Renders the output of `interpreter --binary` as the text the interpreter
+ * would have printed. Usage: render < output.bin
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "output.h"
+
+static uint64_t get_le(const unsigned char *p, size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    value |= (uint64_t) p[i] << (8 * i);
+  }
+  return value;
+}
+
+int main() {
+  std::vector<unsigned char> input;
+  unsigned char chunk[64 * 1024];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), stdin)) > 0) {
+    input.insert(input.end(), chunk, chunk + n);
+  }
+
+  size_t magic_length = strlen(kBinaryMagic);
+  if (input.size() < magic_length
+      || memcmp(input.data(), kBinaryMagic, magic_length) != 0) {
+    fprintf(stderr, "Not a binary output stream\n");
+    return -1;
+  }
+  const unsigned char *p = input.data() + magic_length;
+  const unsigned char *end = input.data() + input.size();
+  while (p < end) {
+    if (end - p < 2) {
+      fprintf(stderr, "Truncated record\n");
+      return -1;
+    }
+    size_t length = get_le(p, 2);
+    p += 2;
+    if ((size_t) (end - p) < length || length < kRecordHeaderLength - 2) {
+      fprintf(stderr, "Truncated record\n");
+      return -1;
+    }
+    const unsigned char *payload = p + kRecordHeaderLength - 2;
+    size_t payload_length = length - (kRecordHeaderLength - 2);
+    if ((*p == kRecordInt && payload_length < 4)
+        || (*p == kRecordDouble && payload_length < 8)) {
+      fprintf(stderr, "Malformed record\n");
+      return -1;
+    }
+    switch (*p) {
+      case kRecordInt:
+        output.write_int((int) (uint32_t) get_le(payload, 4));
+        output.end_line();
+        break;
+      case kRecordDouble:
+        {
+          uint64_t bits = get_le(payload, 8);
+          double value;
+          memcpy(&value, &bits, sizeof(value));
+          output.write_fixed2(value);
+          output.end_line();
+        }
+        break;
+      case kRecordError:
+        {
+          std::string text((const char *) payload, payload_length);
+          output.write(text.c_str());
+          output.end_line();
+        }
+        break;
+      case kRecordProgram:
+        {
+          std::string path((const char *) payload, payload_length);
+          output.print_program(path.c_str());
+        }
+        break;
+      default:
+        // Unknown records are skipped.
+        break;
+    }
+    p += length;
+  }
+  output.finish();
+  return 0;
+}
@@ -0,0 +1,161 @@
+// The only translation unit built as C++20, for its coroutines. The headers
+// it shares with the others are plain C++11.
+#include <coroutine>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "batch.h"
+#include "interpreter.h"
+#include "output.h"
+#include "scheduler.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+/**
+ * A coroutine run by `Scheduler`. It starts suspended, and stays suspended
+ * at its end, so that the scheduler can tell it finished and destroy it.
+ */
+class Task {
+  public:
+  struct promise_type {
+    bool failed = false;
+
+    Task get_return_object() {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept {
+      return {};
+    }
+    std::suspend_always final_suspend() noexcept {
+      return {};
+    }
+    std::suspend_always yield_value(bool) noexcept {
+      return {};
+    }
+    void return_value(bool ok) {
+      failed = !ok;
+    }
+    // The coroutines catch the errors of the programs.
+    void unhandled_exception() {
+      std::terminate();
+    }
+  };
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+  Task(Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+  Task &operator=(Task &&other) noexcept {
+    std::swap(handle, other.handle);
+    return *this;
+  }
+
+  ~Task() {
+    if (handle) {
+      handle.destroy();
+    }
+  }
+
+  // Runs the coroutine until it yields or ends. Returns true if it ended.
+  bool resume() {
+    handle.resume();
+    return handle.done();
+  }
+
+  bool failed() const {
+    return handle.promise().failed;
+  }
+
+  private:
+  std::coroutine_handle<promise_type> handle;
+};
+
+// Yields every `slice` statements. The result is false if the program failed.
+Task run_program(string path, size_t slice, const char *output_dir,
+    Output::Format format) {
+  ProgramOutput program_output(path, output_dir, format);
+  if (!program_output.ok()) {
+    co_return false;
+  }
+  Output &out = program_output.output();
+  unique_ptr<Program> p = compile_program(path, out);
+  bool ok = p != nullptr;
+  if (ok) {
+    p->start();
+    for (;;) {
+      bool more;
+      try {
+        more = p->run_some(out, slice);
+      } catch (const RuntimeError &e) {
+        out.print_error("Runtime error: ", e.what());
+        ok = false;
+        break;
+      } catch (const std::exception &e) {
+        // Would otherwise end every program, see `unhandled_exception()`.
+        out.print_error("Internal error: ", e.what());
+        ok = false;
+        break;
+      }
+      if (!more) {
+        break;
+      }
+      co_yield true;
+    }
+  }
+  program_output.commit();
+  co_return ok;
+}
+
+}  // namespace
+
+int run_batch_interleaved(const char *source, size_t slice,
+    const char *output_dir, size_t max_running) {
+  vector<string> paths;
+  if (!list_programs(source, paths)) {
+    fprintf(stderr, "Cannot read %s: %s\n", source, strerror(errno));
+    return -1;
+  }
+  if (!check_output_names(paths, output_dir)) {
+    return -1;
+  }
+  if (slice == 0) {
+    slice = 1;
+  }
+  if (max_running == 0) {
+    max_running = 1;
+  }
+
+  Output::Format format = output.current_format();
+  std::deque<Task> ready;
+  size_t next_path = 0;
+  bool failed = false;
+  // Round robin, which is fair as every turn runs at most `slice` statements.
+  // Programs are started in order as others finish.
+  for (;;) {
+    while (ready.size() < max_running && next_path != paths.size()) {
+      ready.push_back(
+          run_program(paths[next_path++], slice, output_dir, format));
+    }
+    if (ready.empty()) {
+      break;
+    }
+    Task task = std::move(ready.front());
+    ready.pop_front();
+    if (!task.resume()) {
+      ready.push_back(std::move(task));
+    } else if (task.failed()) {
+      failed = true;
+    }
+  }
+  return failed ? -1 : 0;
+}
@@ -0,0 +1,23 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+#include <cstddef>
+
+/**
+ * Like `run_batch()`, but runs every program on the calling thread, each as a
+ * coroutine that yields after `slice` statements. The coroutines are resumed
+ * in turn, so a short program queued behind long ones finishes after a few
+ * turns rather than after them, and thousands of programs need neither a
+ * thread nor a stack each.
+ *
+ * A program is compiled on its first turn, in one go. At most `max_running`
+ * programs run at a time, and the next ones in the list start as they
+ * finish. Each holds its output, and an open file with `output_dir`, until it
+ * finishes. A lower limit starts fewer long programs ahead of the rest, so
+ * that their compiling does not hold up every program queued behind them.
+ */
+static const size_t kDefaultMaxRunning = 512;
+
+int run_batch_interleaved(const char *source, size_t slice,
+    const char *output_dir, size_t max_running = kDefaultMaxRunning);
+
+#endif
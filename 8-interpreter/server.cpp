@@ -0,0 +1,198 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "batch.h"
+#include "interpreter.h"
+#include "output.h"
+#include "program_cache.h"
+#include "server.h"
+
+using std::string;
+
+static void put_header(char *header, char kind, uint32_t length) {
+  header[0] = kind;
+  for (int i = 0; i < 4; i++) {
+    header[1 + i] = (char) (length >> (8 * i));
+  }
+}
+
+// Writes the frame in one call. Returns false once the client is gone.
+static bool send_frame(int fd, char kind, const char *data, uint32_t length) {
+  char header[kFrameHeaderLength];
+  put_header(header, kind, length);
+  struct iovec parts[2] = {
+    {header, sizeof(header)},
+    {const_cast<char *>(data), length},
+  };
+  struct msghdr message = {};
+  message.msg_iov = parts;
+  message.msg_iovlen = 2;
+  size_t left = sizeof(header) + length;
+  while (left > 0) {
+    // Not raising SIGPIPE when the client is gone.
+    ssize_t n = sendmsg(fd, &message, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    left -= n;
+    // Skips what was sent of a short write.
+    while (n > 0 && (size_t) n >= message.msg_iov->iov_len) {
+      n -= message.msg_iov->iov_len;
+      message.msg_iov++;
+      message.msg_iovlen--;
+    }
+    if (n > 0) {
+      message.msg_iov->iov_base = (char *) message.msg_iov->iov_base + n;
+      message.msg_iov->iov_len -= n;
+    }
+  }
+  return true;
+}
+
+static bool receive(int fd, char *data, size_t size) {
+  while (size > 0) {
+    ssize_t n = recv(fd, data, size, 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+// Streams the output to the client as output frames.
+class SocketSink: public Sink {
+  int fd;
+
+  public:
+  explicit SocketSink(int fd) : fd(fd) {}
+
+  void write(const char *data, size_t size) override {
+    // A client that is gone gets nothing more, but the program still runs.
+    send_frame(fd, kFrameOutput, data, size);
+  }
+};
+
+static RunStatus run_request(const string &source, ProgramCache &cache,
+    Output &out) {
+  try {
+    std::shared_ptr<const Program> p = cache.get(source);
+    Frame frame(p->variable_count());
+    p->run(out, frame);
+  } catch (const CompilingError &e) {
+    out.print_error("Compiling error: ", e.what());
+    return kRunCompilingError;
+  } catch (const RuntimeError &e) {
+    out.print_error("Runtime error: ", e.what());
+    return kRunRuntimeError;
+  } catch (const InternalError &e) {
+    out.print_error("Internal error: ", e.what());
+    return kRunInternalError;
+  } catch (const std::exception &e) {
+    // E.g. `std::logic_error` from `Variable::assign()`, or `bad_alloc`. One
+    // request must not take the server down for every client.
+    out.print_error("Internal error: ", e.what());
+    return kRunInternalError;
+  }
+  return kRunOk;
+}
+
+static void serve_connection(int fd, ProgramCache &cache,
+    Output::Format format) {
+  string payload;
+  char header[kFrameHeaderLength];
+  while (receive(fd, header, sizeof(header))) {
+    uint32_t length = 0;
+    for (int i = 0; i < 4; i++) {
+      length |= (uint32_t) (unsigned char) header[1 + i] << (8 * i);
+    }
+    if (length > kMaxRequestLength
+        || (header[0] != kFrameProgram && header[0] != kFramePath)) {
+      return;
+    }
+    payload.resize(length);
+    if (!receive(fd, &payload[0], length)) {
+      return;
+    }
+
+    Output out(std::unique_ptr<Sink>(new SocketSink(fd)), format);
+    RunStatus status = kRunCompilingError;
+    if (header[0] == kFrameProgram) {
+      status = run_request(payload, cache, out);
+    } else {
+      string source;
+      if (read_program(payload, source, out)) {
+        status = run_request(source, cache, out);
+      }
+    }
+    out.flush();
+    char status_byte = (char) status;
+    if (!send_frame(fd, kFrameStatus, &status_byte, 1)) {
+      return;
+    }
+  }
+}
+
+int serve(const char *socket_path, int jobs) {
+  struct sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (strlen(socket_path) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "Socket path too long: %s\n", socket_path);
+    return -1;
+  }
+  strcpy(address.sun_path, socket_path);
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) {
+    perror("socket");
+    return -1;
+  }
+  unlink(socket_path);
+  if (bind(listener, (struct sockaddr *) &address, sizeof(address)) != 0
+      || listen(listener, SOMAXCONN) != 0) {
+    fprintf(stderr, "Cannot listen on %s: %s\n", socket_path,
+        strerror(errno));
+    close(listener);
+    return -1;
+  }
+
+  ProgramCache cache;
+  Output::Format format = output.current_format();
+  std::vector<std::thread> workers;
+  for (int i = 0; i < (jobs < 1 ? 1 : jobs); i++) {
+    workers.emplace_back([listener, &cache, format]() {
+      for (;;) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+          if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+          }
+          perror("accept");
+          return;
+        }
+        serve_connection(fd, cache, format);
+        close(fd);
+      }
+    });
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  close(listener);
+  return -1;
+}
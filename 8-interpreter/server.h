@@ -0,0 +1,53 @@
+#ifndef SERVER_H
+#define SERVER_H
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * The protocol of `serve()`. Both sides send frames made of
+ *
+ *   kind    uint8, a `FrameKind`
+ *   length  uint32, little-endian, bytes in the payload
+ *   payload
+ *
+ * A client sends a program, or the path of a program file, and the server
+ * answers with the output of the program in any number of output frames,
+ * followed by a status frame. A connection can be used for any number of
+ * requests, one after the other.
+ */
+enum FrameKind {
+  // Requests.
+  kFrameProgram = 'p',
+  kFramePath = 'f',
+  // Responses. The output is in the format of the interpreter's output, but
+  // binary output has no magic number.
+  kFrameOutput = 'o',
+  // The payload is a `RunStatus`, as one byte.
+  kFrameStatus = 'x',
+};
+
+enum RunStatus {
+  kRunOk = 0,
+  // The program could not be read or compiled.
+  kRunCompilingError = 1,
+  kRunRuntimeError = 2,
+  // A bug of the interpreter, which the server survives.
+  kRunInternalError = 3,
+};
+
+const size_t kFrameHeaderLength = 5;
+// Longer requests are refused, and the connection closed.
+const uint32_t kMaxRequestLength = 64 * 1024 * 1024;
+
+/**
+ * Listens on a Unix domain socket at `socket_path`, replacing any file there,
+ * and runs the programs sent to it until killed. Programs are compiled once
+ * and then shared, see `ProgramCache`, so a program sent again costs about
+ * as much as running it.
+ *
+ * `jobs` threads serve one connection each at a time. Returns only if the
+ * socket cannot be set up.
+ */
+int serve(const char *socket_path, int jobs);
+
+#endif
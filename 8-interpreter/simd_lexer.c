@@ -0,0 +1,575 @@
+/**
+ * A hand-written lexer that can replace the flex lexer in lexer.lex. It
+ * returns exactly the same tokens, but classifies 16 (SSE2) or 32 (AVX2)
+ * bytes at a time when skipping spaces, comments, identifiers and numbers,
+ * instead of running a table-driven automaton on every byte.
+ *
+ * Build with `make LEXER=simd`. Add `CXXFLAGS=-mavx2` to use AVX2.
+ *
+ * The file is valid C and C++, so that lexer_test.c can be built with it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "lexer.h"
+#include "line_index.h"
+#include "number.h"
+
+// Bytes that can always be read past the end of the input, so that a whole
+// vector can be loaded at any position before the end.
+#define PADDING 64
+#define READ_SIZE (64 * 1024)
+
+enum char_class {
+  C_OTHER,
+  C_BLANK,
+  C_NEWLINE,
+  C_ALPHA,
+  C_DIGIT,
+  C_OPERATOR,
+  C_SLASH,
+  C_DOT,
+};
+
+static unsigned char char_classes[256];
+
+typedef struct lexer_input {
+  // The buffer holds input from `base_offset` to `base_offset + (end - buffer)`.
+  char *buffer;
+  size_t capacity;
+  char *cur;
+  char *end;
+  long long base_offset;
+  // Null if the whole input is in the buffer.
+  FILE *file;
+  int eof;
+
+  line_index newlines;
+
+  // Like flex, the text of a token is terminated by temporarily replacing the
+  // character following it. Ranges never write to the input, as the bytes
+  // after their end may be read by another thread.
+  int terminate;
+  char *hold_pos;
+  char hold_char;
+} lexer_input;
+
+struct lexer_scanner {
+  lexer_input in;
+  // The file mapped by `lexer_open_file()`, or NULL.
+  char *mapped_base;
+  long mapped_size;
+  // The stream opened by `lexer_open_file()` if the file cannot be mapped, or
+  // NULL.
+  FILE *owned_file;
+};
+
+struct lexer_range {
+  lexer_input in;
+  lexer_scanner *scanner;
+};
+
+// Only used by `lexer()`.
+static lexer_scanner *default_scanner;
+
+static pthread_once_t char_classes_once = PTHREAD_ONCE_INIT;
+
+static void init_char_classes() {
+  const char *operators = "+-*%^~();=";
+  int c;
+  for (c = 'a'; c <= 'z'; c++) {
+    char_classes[c] = C_ALPHA;
+  }
+  for (c = 'A'; c <= 'Z'; c++) {
+    char_classes[c] = C_ALPHA;
+  }
+  char_classes['_'] = C_ALPHA;
+  for (c = '0'; c <= '9'; c++) {
+    char_classes[c] = C_DIGIT;
+  }
+  for (; *operators; operators++) {
+    char_classes[(unsigned char) *operators] = C_OPERATOR;
+  }
+  char_classes['/'] = C_SLASH;
+  char_classes['.'] = C_DOT;
+  char_classes[' '] = C_BLANK;
+  char_classes['\t'] = C_BLANK;
+  char_classes['\r'] = C_BLANK;
+  char_classes['\n'] = C_NEWLINE;
+}
+
+static void reset_input(lexer_input *in, FILE *file) {
+  in->cur = in->end = in->buffer;
+  in->base_offset = 0;
+  in->file = file;
+  in->eof = 0;
+  line_index_reset(&in->newlines);
+  in->terminate = 1;
+  in->hold_pos = NULL;
+}
+
+/**
+ * Reads more input into the buffer, keeping everything from `keep` on.
+ * Returns 0 if there is no more input.
+ */
+static int refill(lexer_input *in, char **keep) {
+  size_t kept;
+  size_t n;
+  if (in->eof || in->file == NULL) {
+    in->eof = 1;
+    return 0;
+  }
+  kept = in->end - *keep;
+  if (*keep != in->buffer) {
+    memmove(in->buffer, *keep, kept);
+    in->base_offset += *keep - in->buffer;
+  }
+  if (in->capacity - kept < READ_SIZE) {
+    in->capacity = in->capacity * 2 + READ_SIZE;
+    in->buffer = (char *) realloc(in->buffer, in->capacity + PADDING);
+  }
+  n = fread(in->buffer + kept, 1, in->capacity - kept, in->file);
+  *keep = in->buffer;
+  in->cur = in->buffer;
+  in->end = in->buffer + kept + n;
+  memset(in->end, 0, PADDING);
+  if (n == 0) {
+    in->eof = 1;
+  }
+  return n > 0;
+}
+
+/**
+ * The functions below return the first position in [p, end) that does not
+ * belong to a class, or `end`. They may read up to a vector past `end`.
+ */
+#if defined(__AVX2__)
+#define VECTOR_SIZE 32
+#define VECTOR_BITS 0xffffffffu
+typedef __m256i vector_t;
+#define v_load(p) _mm256_loadu_si256((const __m256i *) (p))
+#define v_set1(c) _mm256_set1_epi8((char) (c))
+#define v_cmpeq(a, b) _mm256_cmpeq_epi8(a, b)
+#define v_cmpgt(a, b) _mm256_cmpgt_epi8(a, b)
+#define v_or(a, b) _mm256_or_si256(a, b)
+#define v_add(a, b) _mm256_add_epi8(a, b)
+#define v_movemask(a) ((unsigned) _mm256_movemask_epi8(a))
+#elif defined(__SSE2__)
+#define VECTOR_SIZE 16
+#define VECTOR_BITS 0xffffu
+typedef __m128i vector_t;
+#define v_load(p) _mm_loadu_si128((const __m128i *) (p))
+#define v_set1(c) _mm_set1_epi8((char) (c))
+#define v_cmpeq(a, b) _mm_cmpeq_epi8(a, b)
+#define v_cmpgt(a, b) _mm_cmpgt_epi8(a, b)
+#define v_or(a, b) _mm_or_si128(a, b)
+#define v_add(a, b) _mm_add_epi8(a, b)
+#define v_movemask(a) ((unsigned) _mm_movemask_epi8(a))
+#endif
+
+#ifdef VECTOR_SIZE
+// Bytes in [lo, hi]. Shifting by `0x80 - lo` turns the unsigned range check
+// into a single signed comparison.
+static inline vector_t in_range(vector_t v, char lo, char hi) {
+  vector_t shifted = v_add(v, v_set1(0x80 - lo));
+  return v_cmpgt(v_set1(0x80 + (hi - lo) + 1), shifted);
+}
+
+static inline vector_t blank_mask(vector_t v) {
+  return v_or(v_or(v_cmpeq(v, v_set1(' ')), v_cmpeq(v, v_set1('\t'))),
+      v_cmpeq(v, v_set1('\r')));
+}
+
+static inline vector_t digit_mask(vector_t v) {
+  return in_range(v, '0', '9');
+}
+
+static inline vector_t alnum_mask(vector_t v) {
+  return v_or(v_or(in_range(v, 'a', 'z'), in_range(v, 'A', 'Z')),
+      v_or(digit_mask(v), v_cmpeq(v, v_set1('_'))));
+}
+
+#define DEFINE_SKIP(name, mask) \
+  static const char *name(const char *p, const char *end) { \
+    while (p < end) { \
+      unsigned outside = ~v_movemask(mask(v_load(p))) & VECTOR_BITS; \
+      if (outside != 0) { \
+        p += __builtin_ctz(outside); \
+        return p < end ? p : end; \
+      } \
+      p += VECTOR_SIZE; \
+    } \
+    return end; \
+  }
+#else
+static inline int is_blank(char c) {
+  return char_classes[(unsigned char) c] == C_BLANK;
+}
+
+static inline int is_digit(char c) {
+  return char_classes[(unsigned char) c] == C_DIGIT;
+}
+
+static inline int is_alnum(char c) {
+  return char_classes[(unsigned char) c] == C_ALPHA || is_digit(c);
+}
+
+#define DEFINE_SKIP(name, pred) \
+  static const char *name(const char *p, const char *end) { \
+    while (p < end && pred(*p)) { \
+      p++; \
+    } \
+    return p; \
+  }
+#define blank_mask is_blank
+#define digit_mask is_digit
+#define alnum_mask is_alnum
+#endif
+
+DEFINE_SKIP(skip_blanks, blank_mask)
+DEFINE_SKIP(skip_digits, digit_mask)
+DEFINE_SKIP(skip_alnums, alnum_mask)
+
+static int keyword(const char *p, size_t len) {
+  switch (len) {
+    case 3:
+      return memcmp(p, "int", 3) == 0 ? K_INTEGER_TYPE : IDENTIFIER;
+    case 5:
+      if (memcmp(p, "print", 5) == 0) {
+        return K_PRINT;
+      }
+      return memcmp(p, "input", 5) == 0 ? K_INPUT : IDENTIFIER;
+    case 6:
+      return memcmp(p, "double", 6) == 0 ? K_DOUBLE_TYPE : IDENTIFIER;
+  }
+  return IDENTIFIER;
+}
+
+/**
+ * Matches the longest number at `p`, like `int_const` and `double_const` in
+ * lexer.lex, and sets `q` to its end. Returns the token type, or 0 if `p` is a
+ * `.` that does not start a number. Returns -1 if the number may continue
+ * past `end` and there is more input, then the caller must refill and retry.
+ * The byte at `end` is always readable, see `refill()`.
+ */
+static int match_number(const char *p, const char *end, int eof,
+    const char **q) {
+  const char *x = skip_digits(p, end);
+  const char *y;
+  int type = x > p ? INTEGER_LITERAL : 0;
+  if (x == end && !eof) {
+    return -1;
+  }
+  *q = *p == '0' ? p + 1 : x;
+  if (*x == '.') {
+    y = skip_digits(x + 1, end);
+    if (y == end && !eof) {
+      return -1;
+    }
+    if (x > p || y > x + 1) {
+      type = DOUBLE_LITERAL;
+      *q = x = y;
+    }
+  }
+  if (type != 0 && (*x == 'e' || *x == 'E')) {
+    y = x + 1;
+    if (y != end && (*y == '+' || *y == '-')) {
+      y++;
+    }
+    if (y == end && !eof) {
+      return -1;
+    }
+    if (char_classes[(unsigned char) *y] == C_DIGIT) {
+      y = skip_digits(y, end);
+      if (y == end && !eof) {
+        return -1;
+      }
+      type = DOUBLE_LITERAL;
+      *q = y;
+    }
+  }
+  return type;
+}
+
+static void terminate_text(lexer_input *in, char *p) {
+  if (!in->terminate) {
+    return;
+  }
+  in->hold_pos = p;
+  in->hold_char = *p;
+  *p = '\0';
+}
+
+static token scan(lexer_input *in) {
+  token t;
+  char *p;
+  char *q;
+  int c;
+
+  if (in->hold_pos != NULL) {
+    *in->hold_pos = in->hold_char;
+    in->hold_pos = NULL;
+  }
+
+  p = in->cur;
+  for (;;) {
+    // A token is scanned again from `p` if it reaches the end of the buffer
+    // before we are sure it has ended.
+    if (p == in->end) {
+      if (!refill(in, &p)) {
+        t.type = 0;
+        t.offset = (long) (in->base_offset + (p - in->buffer));
+        t.length = 0;
+        t.str_val = NULL;
+        in->cur = p;
+        return t;
+      }
+    }
+    c = char_classes[(unsigned char) *p];
+    if (c == C_BLANK) {
+      p = (char *) skip_blanks(p, in->end);
+      continue;
+    }
+    if (c == C_SLASH && p + 1 == in->end && refill(in, &p)) {
+      continue;
+    }
+    if (c == C_SLASH && p[1] == '/') {
+      // Comments run until the end of the line.
+      q = (char *) memchr(p, '\n', in->end - p);
+      if (q == NULL) {
+        if (refill(in, &p)) {
+          continue;
+        }
+        q = in->end;
+      }
+      p = q;
+      continue;
+    }
+    break;
+  }
+
+  t.offset = (long) (in->base_offset + (p - in->buffer));
+  switch (c) {
+    case C_NEWLINE:
+      line_index_add(&in->newlines, t.offset);
+      t.ops_val = ';';
+      t.type = ';';
+      q = p + 1;
+      break;
+    case C_ALPHA:
+      for (;;) {
+        q = (char *) skip_alnums(p + 1, in->end);
+        if (q != in->end) {
+          break;
+        }
+        if (!refill(in, &p)) {
+          // The buffer may have moved.
+          q = in->end;
+          break;
+        }
+      }
+      t.type = keyword(p, q - p);
+      t.str_val = p;
+      terminate_text(in, q);
+      break;
+    case C_DIGIT:
+    case C_DOT:
+      {
+        const char *end;
+        while ((t.type = match_number(p, in->end, in->eof, &end)) < 0) {
+          // The buffer may have moved, and `in->eof` may be set.
+          refill(in, &p);
+        }
+        q = (char *) end;
+      }
+      if (t.type == INTEGER_LITERAL
+          && parse_int_literal(p, q, &t.int_val) != 0) {
+        t.type = OVERFLOW_LEXEME;
+      } else if (t.type == DOUBLE_LITERAL
+          && parse_double_literal(p, q, &t.double_val) != 0) {
+        t.type = OVERFLOW_LEXEME;
+      } else if (t.type == 0) {
+        t.err_val = *p;
+        t.type = ERROR_LEXEME;
+        q = p + 1;
+      }
+      if (t.type == OVERFLOW_LEXEME) {
+        t.str_val = p;
+        terminate_text(in, q);
+      }
+      break;
+    case C_OPERATOR:
+    case C_SLASH:
+      t.ops_val = *p;
+      t.type = (unsigned char) *p;
+      q = p + 1;
+      break;
+    default:
+      t.err_val = *p;
+      t.type = ERROR_LEXEME;
+      q = p + 1;
+      break;
+  }
+  t.length = (int) (q - p);
+  in->cur = q;
+  return t;
+}
+
+lexer_scanner *lexer_open(FILE *file) {
+  lexer_scanner *scanner = (lexer_scanner *) calloc(1, sizeof(lexer_scanner));
+  pthread_once(&char_classes_once, init_char_classes);
+  scanner->in.capacity = READ_SIZE;
+  scanner->in.buffer = (char *) malloc(scanner->in.capacity + PADDING);
+  reset_input(&scanner->in, file);
+  return scanner;
+}
+
+lexer_scanner *lexer_open_file(const char *path) {
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  size_t size;
+  char *base;
+  lexer_scanner *scanner;
+  if (fd < 0) {
+    return NULL;
+  }
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return NULL;
+  }
+  // Same as lexer.lex, only regular files report the size of what they read.
+  if (!S_ISREG(st.st_mode)) {
+    FILE *file = fdopen(fd, "r");
+    if (file == NULL) {
+      close(fd);
+      return NULL;
+    }
+    scanner = lexer_open(file);
+    scanner->owned_file = file;
+    return scanner;
+  }
+  size = st.st_size;
+
+  // Same as lexer.lex, an anonymous mapping reserves room for the padding
+  // after the file. The mapping is writable, see `terminate_text()`, which
+  // ends up copying every page of the file when it is lexed by one scanner.
+  // Ranges do not write, so lexing in parallel shares the page cache.
+  base = (char *) mmap(NULL, size + PADDING, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return NULL;
+  }
+  if (size > 0 && mmap(base, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    munmap(base, size + PADDING);
+    close(fd);
+    return NULL;
+  }
+  close(fd);
+  madvise(base, size, MADV_SEQUENTIAL);
+
+  scanner = (lexer_scanner *) calloc(1, sizeof(lexer_scanner));
+  pthread_once(&char_classes_once, init_char_classes);
+  scanner->in.buffer = base;
+  scanner->in.capacity = size;
+  reset_input(&scanner->in, NULL);
+  scanner->in.end = base + size;
+  scanner->in.eof = 1;
+  scanner->mapped_base = base;
+  scanner->mapped_size = (long) size;
+  return scanner;
+}
+
+lexer_scanner *lexer_open_buffer(const char *data, size_t size) {
+  lexer_scanner *scanner = (lexer_scanner *) calloc(1, sizeof(lexer_scanner));
+  pthread_once(&char_classes_once, init_char_classes);
+  // Padded with zeros, like a mapped file.
+  scanner->in.capacity = size;
+  scanner->in.buffer = (char *) malloc(size + PADDING);
+  memcpy(scanner->in.buffer, data, size);
+  memset(scanner->in.buffer + size, 0, PADDING);
+  reset_input(&scanner->in, NULL);
+  scanner->in.end = scanner->in.buffer + size;
+  scanner->in.eof = 1;
+  return scanner;
+}
+
+token lexer_next(lexer_scanner *scanner) {
+  return scan(&scanner->in);
+}
+
+void lexer_position(lexer_scanner *scanner, long offset, int *line,
+    int *column) {
+  line_index_find(&scanner->in.newlines, offset, line, column);
+}
+
+void lexer_close(lexer_scanner *scanner) {
+  if (scanner->mapped_base != NULL) {
+    munmap(scanner->mapped_base, scanner->mapped_size + PADDING);
+  } else {
+    free(scanner->in.buffer);
+  }
+  if (scanner->owned_file != NULL) {
+    fclose(scanner->owned_file);
+  }
+  free(scanner->in.newlines.newlines);
+  free(scanner);
+}
+
+token lexer() {
+  if (default_scanner == NULL) {
+    default_scanner = lexer_open(stdin);
+  }
+  return lexer_next(default_scanner);
+}
+
+void yyrestart(FILE *file) {
+  if (default_scanner != NULL) {
+    lexer_close(default_scanner);
+  }
+  default_scanner = lexer_open(file);
+}
+
+const char *lexer_mapped_input(lexer_scanner *scanner, long *size) {
+  *size = scanner->mapped_size;
+  return scanner->mapped_base;
+}
+
+lexer_range *lexer_range_open(lexer_scanner *scanner, long begin, long end) {
+  lexer_range *range = (lexer_range *) calloc(1, sizeof(lexer_range));
+  lexer_input *in = &range->in;
+  range->scanner = scanner;
+  in->buffer = scanner->mapped_base + begin;
+  in->capacity = end - begin;
+  reset_input(in, NULL);
+  in->end = scanner->mapped_base + end;
+  in->base_offset = begin;
+  in->eof = 1;
+  in->terminate = 0;
+  return range;
+}
+
+token lexer_range_next(lexer_range *range) {
+  return scan(&range->in);
+}
+
+void lexer_range_close(lexer_range *range) {
+  line_index *newlines = &range->in.newlines;
+  size_t i;
+  for (i = 0; i < newlines->size; i++) {
+    line_index_add(&range->scanner->in.newlines, newlines->newlines[i]);
+  }
+  free(newlines->newlines);
+  free(range);
+}
@@ -0,0 +1,195 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+/**
+ * A bounded ring buffer connecting one producer thread to one consumer
+ * thread without locks. Each side only writes its own index, and publishes it
+ * with a release store that the other side reads with an acquire load. The
+ * indices are on separate cache lines, so that the two threads do not keep
+ * stealing the line from each other.
+ *
+ * Elements are constructed in place in the ring, and the consumer uses them
+ * in place before releasing their slot, so nothing is copied and `T` does not
+ * need a default constructor.
+ *
+ * A side waiting for the other spins briefly, then yields its time slice, as
+ * the other side may be waiting for the same core, and finally sleeps on a
+ * condition variable, so that a side stalled for long, e.g. behind a long
+ * running statement, costs no CPU. The other side only takes the mutex to
+ * wake it if some side is asleep.
+ */
+template <typename T>
+class SpscQueue {
+  public:
+  // The capacity is rounded up to a power of two.
+  explicit SpscQueue(size_t capacity)
+    : head(0), tail(0), closed(false), abandoned(false), sleepers(0) {
+    size_t size = 1;
+    while (size < capacity) {
+      size *= 2;
+    }
+    mask = size - 1;
+    slots = new Slot[size];
+  }
+
+  // Destroys the elements left, so neither side may still be using it.
+  ~SpscQueue() {
+    size_t t = tail.load(std::memory_order_acquire);
+    for (size_t h = head.load(std::memory_order_acquire); h != t; h++) {
+      reinterpret_cast<T *>(&slots[h & mask])->~T();
+    }
+    delete[] slots;
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // Before C++17, `new` only aligns to the alignment of `max_align_t`, not to
+  // the cache lines of the indices, so the queue allocates itself.
+  static void *operator new(size_t size) {
+    void *p;
+    if (posix_memalign(&p, alignof(SpscQueue), size) != 0) {
+      throw std::bad_alloc();
+    }
+    return p;
+  }
+
+  static void operator delete(void *p) {
+    free(p);
+  }
+
+  // Producer side. Waits while the queue is full. Returns false, without
+  // adding the element, if the consumer has abandoned the queue.
+  template <typename... Args>
+  bool push(Args &&... args) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    auto has_room = [this, t]() {
+      return t - head.load(std::memory_order_acquire) <= mask;
+    };
+    wait_until([this, &has_room]() {
+      return has_room() || abandoned.load(std::memory_order_acquire);
+    });
+    if (!has_room()) {
+      return false;
+    }
+    new (&slots[t & mask]) T(std::forward<Args>(args)...);
+    tail.store(t + 1, std::memory_order_release);
+    wake();
+    return true;
+  }
+
+  // Producer side. No element is pushed after this.
+  void close() {
+    closed.store(true, std::memory_order_release);
+    wake();
+  }
+
+  // Producer side. Waits until the consumer has released every element.
+  void wait_empty() {
+    size_t t = tail.load(std::memory_order_relaxed);
+    wait_until([this, t]() {
+      return head.load(std::memory_order_acquire) == t;
+    });
+  }
+
+  // Consumer side. Waits for the next element, and returns it, or returns
+  // null if the queue is closed and empty. The element stays valid until
+  // `pop_front()`.
+  T *front() {
+    wait_until([this]() {
+      return try_front() != nullptr
+          || closed.load(std::memory_order_acquire);
+    });
+    // An element may have been pushed right before closing.
+    return try_front();
+  }
+
+  // Consumer side. Like `front()`, but returns null right away if the queue
+  // is empty.
+  T *try_front() {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (tail.load(std::memory_order_acquire) == h) {
+      return nullptr;
+    }
+    return reinterpret_cast<T *>(&slots[h & mask]);
+  }
+
+  // Consumer side. Destroys the element returned by `front()`.
+  void pop_front() {
+    size_t h = head.load(std::memory_order_relaxed);
+    reinterpret_cast<T *>(&slots[h & mask])->~T();
+    head.store(h + 1, std::memory_order_release);
+    wake();
+  }
+
+  // Consumer side. Makes `push()` fail from now on, so that the producer can
+  // stop early. The consumer must still drain the queue until it is closed.
+  void abandon() {
+    abandoned.store(true, std::memory_order_release);
+    wake();
+  }
+
+  private:
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+  static const int kSpins = 64;
+  static const int kYields = 64;
+
+  template <typename Ready>
+  void wait_until(Ready ready) {
+    for (int spins = 0; !ready(); spins++) {
+      if (spins < kSpins) {
+        continue;
+      }
+      if (spins < kSpins + kYields) {
+        std::this_thread::yield();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(mutex);
+      sleepers.fetch_add(1, std::memory_order_relaxed);
+      // Pairs with the fence of `wake()`: either the other side sees the
+      // sleeper, or this side sees what the other side did before waking.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      while (!ready()) {
+        wakeup.wait(lock);
+      }
+      sleepers.fetch_sub(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+
+  // Called after changing an index or a flag the other side may wait for.
+  void wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) != 0) {
+      // Under the mutex, so that a side about to sleep is either still before
+      // its last check, or already asleep.
+      std::lock_guard<std::mutex> lock(mutex);
+      wakeup.notify_all();
+    }
+  }
+
+  // Next slot to pop, only written by the consumer.
+  alignas(64) std::atomic<size_t> head;
+  // Next slot to push, only written by the producer.
+  alignas(64) std::atomic<size_t> tail;
+  alignas(64) std::atomic<bool> closed;
+  std::atomic<bool> abandoned;
+  size_t mask;
+  Slot *slots;
+  // Sides asleep in `wait_until()`.
+  std::atomic<int> sleepers;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+};
+
+#endif
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include "output.h"
+#include "statement_graph.h"
+#include "thread_pool.h"
+#include "variable.h"
+
+using std::vector;
+
+namespace {
+
+// The statements that touched a variable since it was last assigned.
+struct VariableAccess {
+  bool assigned = false;
+  uint32_t last_writer = 0;
+  vector<uint32_t> readers;
+};
+
+}
+
+StatementGraph::StatementGraph(const vector<Statement> &statements)
+  : predecessor_counts(statements.size(), 0),
+    first_successor(statements.size() + 1, 0) {
+  vector<std::pair<uint32_t, uint32_t>> edges;
+  std::unordered_map<const Variable *, VariableAccess> accesses;
+  vector<const Variable *> reads;
+  for (uint32_t i = 0; i < statements.size(); i++) {
+    reads.clear();
+    statements[i].collect_reads(reads);
+    for (const Variable *var : reads) {
+      VariableAccess &access = accesses[var];
+      if (access.assigned) {
+        edges.emplace_back(access.last_writer, i);
+      }
+      access.readers.push_back(i);
+    }
+    const Variable *target = statements[i].target();
+    if (target != nullptr) {
+      VariableAccess &access = accesses[target];
+      if (access.assigned) {
+        edges.emplace_back(access.last_writer, i);
+      }
+      for (uint32_t reader : access.readers) {
+        if (reader != i) {
+          edges.emplace_back(reader, i);
+        }
+      }
+      access.readers.clear();
+      access.assigned = true;
+      access.last_writer = i;
+    }
+  }
+
+  // Counting sort of the edges by their source.
+  for (const auto &edge : edges) {
+    first_successor[edge.first + 1]++;
+    predecessor_counts[edge.second]++;
+  }
+  for (size_t i = 0; i < statements.size(); i++) {
+    first_successor[i + 1] += first_successor[i];
+  }
+  successors.resize(edges.size());
+  vector<size_t> next(first_successor.begin(), first_successor.end() - 1);
+  for (const auto &edge : edges) {
+    successors[next[edge.first]++] = edge.second;
+  }
+}
+
+/**
+ * Statements are run by the workers as soon as the statements they depend on
+ * have run, while this thread commits them in program order: it prints the
+ * values of print statements, and stops at the first statement that failed.
+ * Statements after a failed one may already have run, with whatever values
+ * they read, but their output is never written, so the output is the same as
+ * `run()`.
+ *
+ * A statement is only a few nanoseconds of work, so the workers take the lock
+ * once per batch of statements, not once per statement. A worker takes its
+ * share of the ready statements, runs them, and keeps as many of the
+ * statements they made ready for its next batch, so that a chain of dependent
+ * statements stays on one worker. Only the rest go to the shared queue, and
+ * wake the other workers.
+ */
+void Program::run_parallel(int jobs, Output &out) {
+  static const size_t kMaxBatch = 256;
+
+  for (auto &pair: variable_map) {
+    pair.second.reset();
+  }
+  eval_status.clear();
+  const StatementGraph graph(statements);
+  const size_t n = statements.size();
+
+  std::mutex mutex;
+  std::condition_variable has_ready;
+  std::condition_variable has_finished;
+  std::deque<uint32_t> ready;
+  vector<uint32_t> waiting(n);
+  for (size_t i = 0; i < n; i++) {
+    waiting[i] = graph.predecessor_count(i);
+    if (waiting[i] == 0) {
+      ready.push_back(i);
+    }
+  }
+  // Written by the worker running a statement, and read by this thread once
+  // the statement is finished, both under the mutex.
+  vector<Statement::Value> values(n);
+  vector<char> finished(n, 0);
+  vector<char> failed(n, 0);
+  vector<ErrorCode> codes(n);
+  vector<std::exception_ptr> exceptions(n);
+  // Statements after the earliest failure so far are not worth running.
+  size_t first_failure = n;
+  size_t remaining = n;
+  bool stopping = false;
+
+  auto work = [&]() {
+    vector<uint32_t> batch;
+    vector<uint32_t> made_ready;
+    vector<char> ok;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      if (batch.empty()) {
+        has_ready.wait(lock, [&]() {
+          return stopping || remaining == 0 || !ready.empty();
+        });
+        if (stopping || ready.empty()) {
+          return;
+        }
+        size_t share = std::min(kMaxBatch, (ready.size() + jobs - 1) / jobs);
+        batch.assign(ready.begin(), ready.begin() + share);
+        ready.erase(ready.begin(), ready.begin() + share);
+      } else if (stopping) {
+        return;
+      }
+      size_t skip_after = first_failure;
+      lock.unlock();
+
+      ok.assign(batch.size(), 1);
+      for (size_t k = 0; k < batch.size(); k++) {
+        uint32_t i = batch[k];
+        if (i > skip_after) {
+          continue;
+        }
+        try {
+          ok[k] = statements[i].evaluate(&values[i]);
+        } catch (...) {
+          exceptions[i] = std::current_exception();
+          ok[k] = 0;
+        }
+        if (!ok[k]) {
+          codes[i] = eval_status.code;
+          eval_status.clear();
+        }
+      }
+
+      lock.lock();
+      made_ready.clear();
+      for (size_t k = 0; k < batch.size(); k++) {
+        uint32_t i = batch[k];
+        if (!ok[k]) {
+          failed[i] = 1;
+          first_failure = std::min(first_failure, (size_t) i);
+        }
+        finished[i] = 1;
+        for (const uint32_t *s = graph.successors_begin(i);
+            s != graph.successors_end(i); s++) {
+          if (--waiting[*s] == 0) {
+            made_ready.push_back(*s);
+          }
+        }
+      }
+      remaining -= batch.size();
+      size_t keep = std::min(batch.size(), made_ready.size());
+      batch.assign(made_ready.begin(), made_ready.begin() + keep);
+      if (keep < made_ready.size()) {
+        ready.insert(ready.end(), made_ready.begin() + keep, made_ready.end());
+        has_ready.notify_all();
+      }
+      has_finished.notify_one();
+    }
+  };
+
+  ThreadPool pool(jobs);
+  vector<std::future<void>> workers;
+  for (int i = 0; i < jobs; i++) {
+    workers.push_back(pool.submit(work));
+  }
+
+  size_t committed = 0;
+  size_t failure = n;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (committed < n && failure == n) {
+    has_finished.wait(lock, [&]() { return finished[committed] != 0; });
+    size_t end = committed;
+    while (end < n && finished[end] && !failed[end]) {
+      end++;
+    }
+    if (end < n && finished[end]) {
+      failure = end;
+    }
+    // Printing does not need the lock, as finished statements do not change.
+    lock.unlock();
+    for (size_t i = committed; i < end; i++) {
+      if (statements[i].is_print()) {
+        statements[i].print(values[i], out);
+      }
+    }
+    lock.lock();
+    committed = end;
+  }
+  stopping = true;
+  has_ready.notify_all();
+  lock.unlock();
+  for (std::future<void> &worker : workers) {
+    worker.get();
+  }
+
+  if (failure < n) {
+    // Runtime errors are fatal for a program.
+    if (exceptions[failure]) {
+      std::rethrow_exception(exceptions[failure]);
+    }
+    THROW_ERROR(RuntimeError, codes[failure]);
+  }
+}
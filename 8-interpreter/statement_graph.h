@@ -0,0 +1,52 @@
+#ifndef STATEMENT_GRAPH_H
+#define STATEMENT_GRAPH_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "interpreter.h"
+
+/**
+ * Data dependencies between the statements of a program. A statement depends
+ * on an earlier one if it
+ *
+ * - reads a variable last assigned by it,
+ * - assigns a variable also assigned by it, or
+ * - assigns a variable it reads.
+ *
+ * Running every statement after the statements it depends on gives the same
+ * values as running the program in order. Print statements are not ordered
+ * by the graph, as only their output has to be in order, see
+ * `Program::run_parallel()`.
+ *
+ * Edges are stored by their source, as in compressed sparse row matrices.
+ */
+class StatementGraph {
+  public:
+  explicit StatementGraph(const std::vector<Statement> &statements);
+
+  size_t size() const {
+    return predecessor_counts.size();
+  }
+
+  // Number of statements `i` depends on, counting duplicates.
+  uint32_t predecessor_count(size_t i) const {
+    return predecessor_counts[i];
+  }
+
+  // Statements depending on `i`.
+  const uint32_t *successors_begin(size_t i) const {
+    return successors.data() + first_successor[i];
+  }
+
+  const uint32_t *successors_end(size_t i) const {
+    return successors.data() + first_successor[i + 1];
+  }
+
+  private:
+  std::vector<uint32_t> predecessor_counts;
+  // Successors of `i` are in [first_successor[i], first_successor[i + 1]).
+  std::vector<size_t> first_successor;
+  std::vector<uint32_t> successors;
+};
+
+#endif
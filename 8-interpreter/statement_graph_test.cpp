@@ -0,0 +1,264 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "interpreter.h"
+#include "output.h"
+#include "statement_graph.h"
+#define RETURN_STR(...) { \
+  error_str r; \
+  r.len = asprintf(&(r.str), __VA_ARGS__); \
+  return r; \
+}
+#define RETURN_SUCCESS { return SUCCESS; }
+#define ASSERT(condition, ...) { \
+  if (!(condition)) { \
+    RETURN_STR(__VA_ARGS__); \
+  } \
+}
+#define RUN_TEST(func) { \
+  printf("Test %s running...\n", #func); \
+  error_str r = func(); \
+  if (r.len != 0) { \
+    printf("Test %s failed: %s\n", #func, r.str); \
+  } else { \
+    printf("Test %s passed.\n", #func); \
+  } \
+}
+
+using std::string;
+using std::vector;
+
+typedef struct error_str {
+  int len;
+  char *str;
+} error_str;
+const error_str SUCCESS = {0, NULL};
+
+// Expressions are built directly, as the parser cannot read variables until
+// the homework is done.
+
+// `value`, plus the value of `var` if there is one.
+class TestExpr: public Expr {
+  const Variable *var;
+  int value;
+
+  public:
+  TestExpr(const Variable *var, int value)
+    : Expr(Type::Int), var(var), value(value) {}
+
+  void collect_reads(vector<const Variable *> &reads) const override {
+    if (var != nullptr) {
+      reads.push_back(var);
+    }
+  }
+
+  protected:
+  int evaluate_as_int() const override {
+    return var != nullptr ? var->int_val() + value : value;
+  }
+
+  double evaluate_as_double() const override {
+    return evaluate_as_int();
+  }
+};
+
+// Fails with `code`, like a division by zero does.
+class FailingExpr: public Expr {
+  ErrorCode code;
+
+  public:
+  explicit FailingExpr(ErrorCode code) : Expr(Type::Int), code(code) {}
+
+  protected:
+  int evaluate_as_int() const override {
+    fail(code);
+    return 0;
+  }
+
+  double evaluate_as_double() const override {
+    return evaluate_as_int();
+  }
+};
+
+// Statements built by hand, numbered in order.
+struct TestStatements {
+  vector<Statement> statements;
+
+  void assign(Variable &var, const Variable *read, int value = 0) {
+    statements.emplace_back(new TestExpr(read, value), var,
+        statements.size());
+  }
+
+  void print(const Variable *read, int value = 0) {
+    statements.emplace_back(new TestExpr(read, value), statements.size());
+  }
+};
+
+bool has_edge(const StatementGraph &graph, uint32_t from, uint32_t to) {
+  for (const uint32_t *s = graph.successors_begin(from);
+      s != graph.successors_end(from); s++) {
+    if (*s == to) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The variables are inputs, which need no homework, and are given their
+// values by `set_values()` before each run.
+struct TestProgram {
+  static const int kVariables = 8;
+
+  Program program;
+  vector<Variable *> vars;
+
+  TestProgram() {
+    for (int i = 0; i < kVariables; i++) {
+      vars.push_back(&program.create_input("v" + std::to_string(i),
+          Expr::Type::Int));
+    }
+  }
+
+  void set_values() {
+    for (int i = 0; i < kVariables; i++) {
+      vars[i]->assign(i);
+    }
+  }
+
+  // Statements reading and assigning random variables, with a failing
+  // statement at each of `failures`.
+  void append_random(size_t count, const vector<size_t> &failures = {}) {
+    // Always the same program.
+    std::minstd_rand random(1);
+    size_t next_failure = 0;
+    for (size_t i = 0; i < count; i++) {
+      if (next_failure < failures.size() && failures[next_failure] == i) {
+        ErrorCode code = next_failure % 2 == 0
+            ? ErrorCode::DividedByZero
+            : ErrorCode::NonIntegerPowerOfNegative;
+        program.append_print(new FailingExpr(code));
+        next_failure++;
+        continue;
+      }
+      const Variable *read = vars[random() % kVariables];
+      int value = random() % 10;
+      if (random() % 3 == 0) {
+        program.append_print(new TestExpr(read, value));
+      } else {
+        program.append_assignment(new TestExpr(read, value),
+            *vars[random() % kVariables]);
+      }
+    }
+  }
+
+  // Runs the program with `run()` if `jobs` is 0, and returns the output,
+  // followed by the runtime error if there is one.
+  string run(int jobs) {
+    set_values();
+    MemorySink *sink = new MemorySink();
+    Output out(std::unique_ptr<Sink>(sink), Output::Format::Text);
+    string error;
+    try {
+      if (jobs == 0) {
+        program.run(out);
+      } else {
+        program.run_parallel(jobs, out);
+      }
+    } catch (const RuntimeError &e) {
+      error = string("Runtime error: ") + e.what();
+    }
+    out.flush();
+    return sink->text() + error;
+  }
+};
+
+error_str test_graph_edges() {
+  TestProgram p;
+  Variable &a = *p.vars[0];
+  Variable &b = *p.vars[1];
+  TestStatements s;
+  s.assign(a, nullptr, 1);  // 0: a = 1
+  s.assign(b, &a, 1);       // 1: b = a + 1
+  s.print(&a);              // 2: print a
+  s.assign(a, nullptr, 2);  // 3: a = 2
+  s.print(&b);              // 4: print b
+  s.print(nullptr, 3);      // 5: print 3
+  StatementGraph graph(s.statements);
+
+  ASSERT(graph.size() == 6, "Expecting 6 statements.");
+  // Reading after writing.
+  ASSERT(has_edge(graph, 0, 1) && has_edge(graph, 0, 2)
+      && has_edge(graph, 1, 4), "Missing an edge from a write to a read.");
+  // Writing after writing, and writing after reading.
+  ASSERT(has_edge(graph, 0, 3), "Missing an edge between writes.");
+  ASSERT(has_edge(graph, 1, 3) && has_edge(graph, 2, 3),
+      "Missing an edge from a read to a write.");
+  ASSERT(graph.predecessor_count(0) == 0 && graph.predecessor_count(1) == 1
+      && graph.predecessor_count(2) == 1 && graph.predecessor_count(3) == 3
+      && graph.predecessor_count(4) == 1 && graph.predecessor_count(5) == 0,
+      "Unexpected predecessor counts.");
+  ASSERT(graph.successors_begin(5) == graph.successors_end(5)
+      && graph.successors_begin(4) == graph.successors_end(4),
+      "Expecting no successors for the last statements.");
+  RETURN_SUCCESS;
+}
+
+error_str test_graph_independent() {
+  TestProgram p;
+  TestStatements s;
+  for (int i = 0; i < TestProgram::kVariables; i++) {
+    s.assign(*p.vars[i], nullptr, i);
+    s.print(nullptr, i);
+  }
+  StatementGraph graph(s.statements);
+  for (size_t i = 0; i < graph.size(); i++) {
+    ASSERT(graph.predecessor_count(i) == 0
+        && graph.successors_begin(i) == graph.successors_end(i),
+        "Expecting statement %zu to be independent.", i);
+  }
+  RETURN_SUCCESS;
+}
+
+error_str test_parallel_order() {
+  TestProgram p;
+  p.append_random(20000);
+  string expected = p.run(0);
+  ASSERT(!expected.empty() && expected.find("error") == string::npos,
+      "Unexpected output of run().");
+  for (int jobs : {1, 2, 3, 8}) {
+    string actual = p.run(jobs);
+    ASSERT(actual == expected, "Different output with %d jobs.", jobs);
+  }
+  RETURN_SUCCESS;
+}
+
+error_str test_parallel_failure() {
+  // The first failure is the one reported, and nothing after it is printed,
+  // even if it has already run.
+  for (size_t failure : {0, 1, 5000, 19999}) {
+    TestProgram p;
+    p.append_random(20000, {failure, failure + 10});
+    string expected = p.run(0);
+    ASSERT(expected.find("Runtime error: ") != string::npos,
+        "Expecting a runtime error at statement %zu.", failure);
+    for (int jobs : {1, 2, 3, 8}) {
+      string actual = p.run(jobs);
+      ASSERT(actual == expected,
+          "Different output with %d jobs and a failure at statement %zu.",
+          jobs, failure);
+    }
+  }
+  RETURN_SUCCESS;
+}
+
+int main() {
+  RUN_TEST(test_graph_edges);
+  RUN_TEST(test_graph_independent);
+  RUN_TEST(test_parallel_order);
+  RUN_TEST(test_parallel_failure);
+  return 0;
+}
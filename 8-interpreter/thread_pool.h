@@ -0,0 +1,44 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed number of worker threads running tasks from a shared queue. Tasks
+ * are started in the order they are submitted, but may finish in any order,
+ * so callers that need ordered results wait on the returned futures in order.
+ */
+class ThreadPool {
+  public:
+  explicit ThreadPool(int threads);
+
+  // Runs the tasks still queued, then joins the workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // The future becomes ready when the task has run. An exception thrown by
+  // the task is rethrown by `get()`.
+  std::future<void> submit(std::function<void()> task);
+
+  int size() const {
+    return (int) workers.size();
+  }
+
+  private:
+  std::mutex mutex;
+  std::condition_variable has_task;
+  std::deque<std::packaged_task<void()>> tasks;
+  bool stopping;
+  std::vector<std::thread> workers;
+
+  void work();
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include <cstring>
+#include "lexer.h"
+#include "token_buffer.h"
+
+void TokenBuffer::Tokens::clear() {
+  types.clear();
+  offsets.clear();
+  payloads.clear();
+  text.clear();
+}
+
+void TokenBuffer::Tokens::append(const token &t) {
+  Payload payload;
+  switch (t.type) {
+    case IDENTIFIER:
+    case K_INTEGER_TYPE:
+    case K_DOUBLE_TYPE:
+    case K_PRINT:
+    case K_INPUT:
+    case OVERFLOW_LEXEME:
+      payload.text_offset = text.size();
+      text.insert(text.end(), t.str_val, t.str_val + t.length);
+      text.push_back('\0');
+      break;
+    case INTEGER_LITERAL:
+      payload.int_val = t.int_val;
+      break;
+    case DOUBLE_LITERAL:
+      payload.double_val = t.double_val;
+      break;
+    case ERROR_LEXEME:
+      payload.char_val = t.err_val;
+      break;
+    default:
+      payload.char_val = t.ops_val;
+      break;
+  }
+  types.push_back(t.type);
+  offsets.push_back(t.offset);
+  payloads.push_back(payload);
+}
+
+TokenBuffer::TokenBuffer(lexer_scanner *scanner, size_t chunk_size,
+    int threads)
+  : scanner(scanner), chunk_size(chunk_size), pos(0), input(nullptr),
+    input_size(0), next_chunk_begin(0) {
+  if (threads > 1) {
+    input = lexer_mapped_input(scanner, &input_size);
+  }
+  if (input != nullptr) {
+    for (int i = 0; i < threads; i++) {
+      start_chunk();
+    }
+  }
+}
+
+TokenBuffer::~TokenBuffer() {
+  // The threads still use their ranges.
+  for (Chunk &chunk : chunks) {
+    chunk.tokens.wait();
+    lexer_range_close(chunk.range);
+  }
+  stop_lexer_thread();
+}
+
+void TokenBuffer::stop_lexer_thread() {
+  if (!lexer_thread.joinable()) {
+    return;
+  }
+  // Stops the lexer at its next chunk.
+  lexed->abandon();
+  while (lexed->front() != nullptr) {
+    lexed->pop_front();
+  }
+  lexer_thread.join();
+}
+
+void TokenBuffer::lex_on_thread() {
+  if (input != nullptr) {
+    return;
+  }
+  lexed.reset(new SpscQueue<Tokens>(kChunksAhead));
+  // Holds every chunk in use, so that returning one never waits.
+  recycled.reset(new SpscQueue<Tokens>(kChunksAhead + 2));
+  lexer_thread = std::thread(&TokenBuffer::lex_ahead, this);
+}
+
+void TokenBuffer::lex_ahead() {
+  token t;
+  do {
+    Tokens chunk;
+    Tokens *old = recycled->try_front();
+    if (old != nullptr) {
+      chunk = std::move(*old);
+      recycled->pop_front();
+      chunk.clear();
+    }
+    do {
+      t = lexer_next(scanner);
+      chunk.append(t);
+    } while (t.type != 0 && chunk.types.size() != chunk_size);
+    if (!lexed->push(std::move(chunk))) {
+      break;
+    }
+  } while (t.type != 0);
+  lexed->close();
+}
+
+void TokenBuffer::fill() {
+  if (lexed) {
+    fill_from_thread();
+    return;
+  }
+  tokens.clear();
+  pos = 0;
+  if (input != nullptr) {
+    fill_parallel();
+    return;
+  }
+
+  token t;
+  do {
+    t = lexer_next(scanner);
+    tokens.append(t);
+  } while (t.type != 0 && tokens.types.size() != chunk_size);
+}
+
+TokenBuffer::Tokens TokenBuffer::lex_range(lexer_range *range) {
+  Tokens tokens;
+  token t;
+  // The end of a range is not the end of the input.
+  while ((t = lexer_range_next(range)).type != 0) {
+    tokens.append(t);
+  }
+  return tokens;
+}
+
+void TokenBuffer::start_chunk() {
+  if (next_chunk_begin == input_size) {
+    return;
+  }
+  long begin = next_chunk_begin;
+  long end = input_size;
+  if (input_size - begin > kParallelChunkBytes) {
+    // Ends right after a newline, so that no token is split.
+    const char *newline = (const char *) memchr(
+        input + begin + kParallelChunkBytes - 1, '\n',
+        input_size - begin - kParallelChunkBytes + 1);
+    if (newline != nullptr) {
+      end = newline - input + 1;
+    }
+  }
+  next_chunk_begin = end;
+
+  Chunk chunk;
+  chunk.range = lexer_range_open(scanner, begin, end);
+  chunk.tokens = std::async(std::launch::async, lex_range, chunk.range);
+  chunks.push_back(std::move(chunk));
+}
+
+void TokenBuffer::fill_parallel() {
+  // A chunk of blank lines or comments has no tokens.
+  while (!chunks.empty()) {
+    Chunk chunk = std::move(chunks.front());
+    chunks.pop_front();
+    tokens = chunk.tokens.get();
+    // Closed in order, so that the newlines are added in order.
+    lexer_range_close(chunk.range);
+    start_chunk();
+    if (!tokens.types.empty()) {
+      return;
+    }
+  }
+  token end = {};
+  end.offset = input_size;
+  tokens.append(end);
+}
+
+void TokenBuffer::fill_from_thread() {
+  // The lexer closes the queue after the chunk with the end of the input,
+  // which is returned again when read past, like the lexer does.
+  Tokens *chunk = lexed->front();
+  if (chunk == nullptr) {
+    long end = tokens.offsets.back();
+    tokens.clear();
+    token t = {};
+    t.offset = end;
+    tokens.append(t);
+    pos = 0;
+    return;
+  }
+  recycled->push(std::move(tokens));
+  tokens = std::move(*chunk);
+  lexed->pop_front();
+  pos = 0;
+}
@@ -0,0 +1,158 @@
+#ifndef TOKEN_BUFFER_H
+#define TOKEN_BUFFER_H
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "lexer.h"
+#include "diagnostic.h"
+#include "spsc_queue.h"
+
+/**
+ * Tokens lexed ahead of the parser, stored as parallel arrays rather than as
+ * an array of `token`s. The lexer fills the buffer in one tight loop, a chunk
+ * of tokens at a time, and the parser reads the tokens back by index.
+ *
+ * Text of identifiers and keywords is copied into `text`, as the lexer reuses
+ * its own buffer. It stays valid until the buffer is filled again, so callers
+ * must copy it if they need to keep it.
+ *
+ * A mapped file can also be lexed on several threads. It is then split into
+ * chunks of whole lines, which are lexed concurrently a few chunks ahead of
+ * the parser, and handed to the parser in order.
+ *
+ * Otherwise the input can be lexed on a thread of its own, see
+ * `lex_on_thread()`, which hands chunks to the parser through a ring buffer.
+ */
+class TokenBuffer {
+  public:
+  // Tokens lexed per chunk. Zero means lexing the whole input at once.
+  static const size_t kDefaultChunkSize = 64 * 1024;
+  // Bytes of input per chunk when lexing on several threads.
+  static const long kParallelChunkBytes = 4 * 1024 * 1024;
+
+  // With more than one thread, the input is lexed in parallel if the lexer
+  // supports it, see `lexer_mapped_input()`, and `chunk_size` is unused. The
+  // scanner is not owned by the buffer, and must outlive it.
+  TokenBuffer(lexer_scanner *scanner, size_t chunk_size = kDefaultChunkSize,
+      int threads = 1);
+
+  ~TokenBuffer();
+
+  // Lexes the rest of the input on another thread, a few chunks ahead of the
+  // parser. Must be called before `next()`. Has no effect when lexing in
+  // parallel.
+  void lex_on_thread();
+
+  // Returns the index of the next token, lexing another chunk if needed. An
+  // index is valid until `next()` is called again.
+  size_t next() {
+    if (pos == tokens.types.size()) {
+      fill();
+    }
+    return pos++;
+  }
+
+  // True once the end of the input has been returned by `next()`.
+  bool at_end() const {
+    return pos > 0 && tokens.types[pos - 1] == 0;
+  }
+
+  int type(size_t i) const {
+    return tokens.types[i];
+  }
+
+  long offset(size_t i) const {
+    return tokens.offsets[i];
+  }
+
+  // Only computed on demand, as it searches the lexer's newline index.
+  Position position(size_t i) {
+    return position_at(tokens.offsets[i]);
+  }
+
+  // Meant for reporting errors. With `lex_on_thread()`, the lexer thread is
+  // stopped first, as it keeps growing the newline index, and the buffer then
+  // ends after the tokens already returned. The newlines before them are all
+  // in the index by then.
+  Position position_at(long offset) {
+    stop_lexer_thread();
+    Position position;
+    lexer_position(scanner, offset, &position.line, &position.column);
+    return position;
+  }
+
+  int int_val(size_t i) const {
+    return tokens.payloads[i].int_val;
+  }
+
+  double double_val(size_t i) const {
+    return tokens.payloads[i].double_val;
+  }
+
+  char ops_val(size_t i) const {
+    return tokens.payloads[i].char_val;
+  }
+
+  char err_val(size_t i) const {
+    return tokens.payloads[i].char_val;
+  }
+
+  const char *str_val(size_t i) const {
+    return &tokens.text[tokens.payloads[i].text_offset];
+  }
+
+  private:
+  union Payload {
+    int int_val;
+    double double_val;
+    char char_val;
+    size_t text_offset;
+  };
+
+  struct Tokens {
+    std::vector<int> types;
+    std::vector<long> offsets;
+    std::vector<Payload> payloads;
+    std::vector<char> text;
+
+    void clear();
+    void append(const token &t);
+  };
+
+  // A range of the input being lexed on another thread.
+  struct Chunk {
+    lexer_range *range;
+    std::future<Tokens> tokens;
+  };
+
+  lexer_scanner *scanner;
+  const size_t chunk_size;
+  size_t pos;
+  Tokens tokens;
+
+  // Only used when lexing in parallel.
+  const char *input;
+  long input_size;
+  long next_chunk_begin;
+  std::deque<Chunk> chunks;
+
+  // Chunks lexed ahead by `lex_on_thread()`, and chunks returned by the
+  // parser for their memory to be reused.
+  static const size_t kChunksAhead = 4;
+  std::unique_ptr<SpscQueue<Tokens>> lexed;
+  std::unique_ptr<SpscQueue<Tokens>> recycled;
+  std::thread lexer_thread;
+
+  void fill();
+  void fill_parallel();
+  void fill_from_thread();
+  void lex_ahead();
+  void stop_lexer_thread();
+  void start_chunk();
+  static Tokens lex_range(lexer_range *range);
+};
+
+#endif
@@ -1,57 +1,164 @@
 #ifndef VARIABLE_H
 #define VARIABLE_H
+#include <cstdint>
 #include <stdexcept>
+#include <vector>
 
-class Variable {
-  Expr::Type type_;
+// The value of a variable in one run of a program.
+struct VariableValue {
   bool initialized;
   union {
-    int int_val_;
-    double double_val_;
+    int int_val;
+    double double_val;
   };
+};
+
+/**
+ * The values of all the variables of a program, for one run of it. Variables
+ * keep their values in themselves, unless the running thread has a frame,
+ * see `FrameScope`, in which case they use their slot in the frame instead.
+ * A compiled program can then be run by several threads at once, each with a
+ * frame of its own. See `Program::number_variables()`.
+ */
+class Frame {
+  std::vector<VariableValue> values;
+
   public:
-  Variable(Expr::Type type) : type_(type), initialized(false) {}
+  explicit Frame(size_t size) : values(size) {}
+
+  VariableValue &operator[](uint32_t slot) {
+    return values[slot];
+  }
+
+  const VariableValue &operator[](uint32_t slot) const {
+    return values[slot];
+  }
+
+  // Marks the variables from slot `first` on as initialized, see
+  // `Variable::reset()`. The inputs of a program come first, and keep the
+  // values bound to them, see `Program::bind()`.
+  void reset(uint32_t first = 0) {
+    for (size_t slot = first; slot < values.size(); slot++) {
+      values[slot].initialized = true;
+    }
+  }
+};
+
+extern thread_local Frame *current_frame;
+
+// Runs the variables of this thread in `frame` while in scope.
+class FrameScope {
+  Frame *saved;
+
+  public:
+  explicit FrameScope(Frame &frame) : saved(current_frame) {
+    current_frame = &frame;
+  }
+
+  ~FrameScope() {
+    current_frame = saved;
+  }
+
+  FrameScope(const FrameScope &) = delete;
+  FrameScope &operator=(const FrameScope &) = delete;
+};
+
+class Variable {
+  Expr::Type type_;
+  // Index of the variable in a `Frame`.
+  uint32_t slot_;
+  // The value when the thread has no frame.
+  VariableValue own;
+  // Set by the program, see `Program::create_input()`.
+  bool input_;
+
+  const VariableValue &value() const {
+    return current_frame == nullptr ? own : (*current_frame)[slot_];
+  }
+
+  VariableValue &value() {
+    return current_frame == nullptr ? own : (*current_frame)[slot_];
+  }
+
+  public:
+  Variable(Expr::Type type) : type_(type), slot_(0), input_(false) {
+    own.initialized = false;
+  }
 
   Expr::Type type() const {
     return type_;
   }
 
+  uint32_t slot() const {
+    return slot_;
+  }
+
+  void set_slot(uint32_t slot) {
+    slot_ = slot;
+  }
+
+  // An input has no initial value, it is given one before each run instead.
+  // Reading an input that was not given a value is a runtime error.
+  bool is_input() const {
+    return input_;
+  }
+
+  void set_input() {
+    input_ = true;
+  }
+
   void assign(double value) {
     if (type() != Expr::Type::Double) {
       throw std::logic_error("Assigning double value to non-double variable.");
     }
-    double_val_ = value;
+    VariableValue &stored = this->value();
+    stored.double_val = value;
+    // Only matters for inputs, see `reset()`.
+    stored.initialized = true;
   }
 
   void assign(int value) {
     if (type() != Expr::Type::Int) {
       throw std::logic_error("Assigning int value to non-int variable.");
     }
-    int_val_ = value;
+    VariableValue &stored = this->value();
+    stored.int_val = value;
+    // Only matters for inputs, see `reset()`.
+    stored.initialized = true;
   }
 
+  // Marks the variable as initialized before a run, unless it is an input.
   void reset() {
-    initialized = true;
+    if (!input_) {
+      value().initialized = true;
+    }
   }
 
+  // Reading a variable may fail at runtime. See `EvalStatus`.
   int int_val() const {
-    if (!initialized) {
-      throw std::logic_error("Evaluating uninitialized variable.");
+    const VariableValue &value = this->value();
+    if (!value.initialized) {
+      eval_status.fail(ErrorCode::UninitializedVariable);
+      return 0;
     }
     if (type() != Expr::Type::Int) {
-      throw std::logic_error("Referencing non-int value as int.");
+      eval_status.fail(ErrorCode::VariableAsInt);
+      return 0;
     }
-    return int_val_;
+    return value.int_val;
   }
 
   double double_val() const {
-    if (!initialized) {
-      throw std::logic_error("Evaluating uninitialized variable.");
+    const VariableValue &value = this->value();
+    if (!value.initialized) {
+      eval_status.fail(ErrorCode::UninitializedVariable);
+      return 0.0;
     }
     if (type() != Expr::Type::Double) {
-      throw std::logic_error("Referencing non-double value as double.");
+      eval_status.fail(ErrorCode::VariableAsDouble);
+      return 0.0;
     }
-    return double_val_;
+    return value.double_val;
   }
 
   // Asking the C++ compiler to disable the following functions, so that we
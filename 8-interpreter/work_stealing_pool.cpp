@@ -0,0 +1,94 @@
+#include "work_stealing_pool.h"
+
+// The pool and the deque of the worker running on this thread, if any.
+static thread_local const WorkStealingPool *current_pool = nullptr;
+static thread_local size_t current_queue = 0;
+
+WorkStealingPool::WorkStealingPool(int threads)
+  : next_queue(0), queued(0), unfinished(0), stopping(false) {
+  for (int i = 0; i < threads; i++) {
+    queues.emplace_back(new Queue());
+  }
+  for (int i = 0; i < threads; i++) {
+    workers.emplace_back(&WorkStealingPool::work, this, (size_t) i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  has_task.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+  size_t i = current_pool == this
+    ? current_queue : next_queue.fetch_add(1) % queues.size();
+  unfinished++;
+  queued++;
+  {
+    std::lock_guard<std::mutex> lock(queues[i]->mutex);
+    queues[i]->tasks.push_back(std::move(task));
+  }
+  // Taking the lock orders the increment before a worker going to sleep
+  // checks it, so the wake up is not lost.
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+  }
+  has_task.notify_one();
+}
+
+void WorkStealingPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  all_done.wait(lock, [this]() { return unfinished == 0; });
+}
+
+bool WorkStealingPool::take(size_t self, std::function<void()> &task) {
+  {
+    Queue &own = *queues[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (size_t k = 1; k < queues.size(); k++) {
+    Queue &victim = *queues[(self + k) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::work(size_t self) {
+  current_pool = this;
+  current_queue = self;
+  std::function<void()> task;
+  for (;;) {
+    if (take(self, task)) {
+      queued--;
+      task();
+      task = nullptr;
+      if (--unfinished == 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        all_done.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    has_task.wait(lock, [this]() { return stopping || queued > 0; });
+    if (stopping && queued == 0) {
+      return;
+    }
+  }
+}
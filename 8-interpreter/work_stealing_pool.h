@@ -0,0 +1,62 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A thread pool where each worker has a deque of tasks of its own. A worker
+ * runs the newest task at the back of its deque, and once it is empty, steals
+ * the oldest task at the front of another worker's deque. Workers mostly use
+ * their own deque, so they rarely wait for each other, and idle workers take
+ * over the work of busy ones when tasks take very different times.
+ *
+ * Tasks submitted by a task go to the deque of its worker. Others are dealt
+ * to the workers in turn. Tasks must not throw.
+ */
+class WorkStealingPool {
+  public:
+  explicit WorkStealingPool(int threads);
+
+  // Waits for every task, then joins the workers.
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  void submit(std::function<void()> task);
+
+  // Waits until every task submitted so far has run.
+  void wait();
+
+  private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  // Where the next task from outside the pool goes.
+  std::atomic<size_t> next_queue;
+  // Tasks in the deques, and tasks not finished yet.
+  std::atomic<size_t> queued;
+  std::atomic<size_t> unfinished;
+
+  // Only for sleeping and waking up.
+  std::mutex mutex;
+  std::condition_variable has_task;
+  std::condition_variable all_done;
+  bool stopping;
+
+  bool take(size_t self, std::function<void()> &task);
+  void work(size_t self);
+};
+
+#endif